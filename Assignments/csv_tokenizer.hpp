@@ -0,0 +1,300 @@
+#pragma once
+// Shared CSV tokenizer for finalcode.cpp and Trigger.cpp.
+// Files are memory-mapped and split into std::string_view fields; only fields
+// that contain quotes are copied (into a caller-owned scratch buffer).
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cstddef>
+#include <cmath>
+#include <charconv>
+#include <system_error>
+#include <ostream>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CSV_TOKENIZER_SSE2 1
+#endif
+#ifdef _WIN32
+#include <intrin.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// ───────────────────────────── read-only file mapping
+// POSIX: mmap. Windows: the file is read into memory instead.
+class MappedFile{
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile(){ close(); }
+
+    bool open(const std::string& path){
+        close();
+#ifdef _WIN32
+        std::ifstream in(path, std::ios::binary);
+        if(!in) return false;
+        std::ostringstream ss; ss<<in.rdbuf();
+        buf_ = ss.str();
+        data_ = buf_.data(); size_ = buf_.size();
+        return true;
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if(fd<0) return false;
+        struct stat sb{};
+        if(::fstat(fd, &sb)!=0){ ::close(fd); return false; }
+        size_ = (size_t)sb.st_size;
+        if(size_>0){
+            void* p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(p==MAP_FAILED){ ::close(fd); size_=0; return false; }
+            ::madvise(p, size_, MADV_SEQUENTIAL);
+            map_ = p; data_ = (const char*)p;
+        }
+        ::close(fd);
+        return true;
+#endif
+    }
+    void close(){
+#ifndef _WIN32
+        if(map_) ::munmap(map_, size_);
+#endif
+        map_=nullptr; data_=nullptr; size_=0; buf_.clear();
+    }
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    std::string_view view() const { return {data_, size_}; }
+
+private:
+    void* map_ = nullptr;
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    std::string buf_;
+};
+
+// ───────────────────────────── byte scanning
+static inline unsigned csv_ctz(unsigned m){
+#ifdef _MSC_VER
+    unsigned long i; _BitScanForward(&i, m); return (unsigned)i;
+#else
+    return (unsigned)__builtin_ctz(m);
+#endif
+}
+// First ',' or '"' in [p,end), 16 bytes per step when SSE2 is available
+static inline const char* csv_find_delim(const char* p, const char* end){
+#ifdef CSV_TOKENIZER_SSE2
+    const __m128i comma = _mm_set1_epi8(','), quote = _mm_set1_epi8('"');
+    while(end-p >= 16){
+        __m128i v = _mm_loadu_si128((const __m128i*)p);
+        unsigned m = (unsigned)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, comma),
+                                                              _mm_cmpeq_epi8(v, quote)));
+        if(m) return p + csv_ctz(m);
+        p += 16;
+    }
+#endif
+    while(p<end && *p!=',' && *p!='"') ++p;
+    return p;
+}
+// First '"' in [p,end)
+static inline const char* csv_find_quote(const char* p, const char* end){
+    const void* q = std::memchr(p, '"', (size_t)(end-p));
+    return q ? (const char*)q : end;
+}
+
+// ───────────────────────────── lines
+// Next line of buf starting at pos (without '\n' / trailing '\r'); false at end.
+// A UTF-8 BOM at the very start of the buffer is skipped.
+static inline bool csv_next_line(std::string_view buf, size_t& pos, std::string_view& line){
+    if(pos==0 && buf.size()>=3 && (unsigned char)buf[0]==0xEF &&
+       (unsigned char)buf[1]==0xBB && (unsigned char)buf[2]==0xBF) pos=3;
+    if(pos>=buf.size()) return false;
+    const char* b = buf.data()+pos;
+    const void* nl = std::memchr(b, '\n', buf.size()-pos);
+    size_t len = nl ? (size_t)((const char*)nl - b) : buf.size()-pos;
+    pos += len + (nl ? 1 : 0);
+    if(len && b[len-1]=='\r') --len;
+    line = std::string_view(b, len);
+    return true;
+}
+static inline bool csv_blank(std::string_view s){
+    for(char c: s) if(c!=' ' && c!='\t' && c!='\r' && c!='\n') return false;
+    return true;
+}
+// Next line that is not blank
+static inline bool csv_next_nonempty_line(std::string_view buf, size_t& pos, std::string_view& line){
+    while(csv_next_line(buf, pos, line)) if(!csv_blank(line)) return true;
+    return false;
+}
+
+// Next record: like csv_next_line, but a newline inside a quoted field does not end it
+static inline bool csv_next_record(std::string_view buf, size_t& pos, std::string_view& rec){
+    if(pos==0 && buf.size()>=3 && (unsigned char)buf[0]==0xEF &&
+       (unsigned char)buf[1]==0xBB && (unsigned char)buf[2]==0xBF) pos=3;
+    if(pos>=buf.size()) return false;
+    const char* b = buf.data()+pos;
+    const char* end = buf.data()+buf.size();
+    const char* e = b;
+    bool inq = false;
+    while(true){
+        const char* nl = (const char*)std::memchr(e, '\n', (size_t)(end-e));
+        if(!nl) nl = end;
+        for(const char* q=e; q<nl; ++q){
+            q = (const char*)std::memchr(q, '"', (size_t)(nl-q));
+            if(!q) break;
+            inq = !inq;
+        }
+        if(!inq || nl==end){ e = nl; break; }
+        e = nl+1;
+    }
+    size_t len = (size_t)(e-b);
+    pos += len + (e<end ? 1 : 0);
+    if(len && b[len-1]=='\r') --len;
+    rec = std::string_view(b, len);
+    return true;
+}
+
+// ───────────────────────────── chunking for parallel parsing
+// Split buf (starting outside quotes) into about `parts` record-aligned slices.
+// Returns boundaries b[0]=0 < ... < b[k]=size. Quote parity at each nominal
+// split is taken from per-slice quote counts (counted on up to `threads`
+// workers, 0 = one per core), so a newline inside a quoted field is never used
+// as a boundary.
+static inline std::vector<size_t> csv_chunk_bounds(std::string_view buf, size_t parts, unsigned threads = 0){
+    const size_t n = buf.size();
+    std::vector<size_t> out{0};
+    if(parts<=1 || n<parts*4096){ out.push_back(n); return out; }
+
+    std::vector<size_t> nominal(parts+1);
+    for(size_t k=0;k<=parts;++k) nominal[k] = n*k/parts;
+    std::vector<size_t> quotes(parts, 0);
+    {
+        if(threads==0) threads = std::max(1u, std::thread::hardware_concurrency());
+        std::atomic<size_t> next{0};
+        auto work = [&]{
+            for(size_t k; (k = next++) < parts; )
+                quotes[k] = (size_t)std::count(buf.begin()+nominal[k], buf.begin()+nominal[k+1], '"');
+        };
+        std::vector<std::thread> pool;
+        const size_t nWorkers = std::min<size_t>(threads, parts);
+        for(size_t t=1;t<nWorkers;++t) pool.emplace_back(work);
+        work();
+        for(auto& t: pool) t.join();
+    }
+    size_t parity = 0;
+    for(size_t k=1;k<parts;++k){
+        parity += quotes[k-1];
+        bool inq = (parity & 1)!=0;
+        size_t i = nominal[k];
+        for(; i<n; ++i){
+            if(buf[i]=='"') inq = !inq;
+            else if(buf[i]=='\n' && !inq){ ++i; break; }
+        }
+        if(i>out.back() && i<n) out.push_back(i);
+    }
+    out.push_back(n);
+    return out;
+}
+
+// ───────────────────────────── fields
+// Split one line on commas. Quoted sections may contain commas and "" escapes;
+// such fields are unescaped into `scratch` (reserved up front so views stay valid).
+// Fields are not trimmed. At most `limit` fields are split off (the rest of the line is skipped).
+static inline void csv_split_views(std::string_view line,
+                                   std::vector<std::string_view>& out,
+                                   std::string& scratch,
+                                   size_t limit = std::string_view::npos)
+{
+    out.clear();
+    scratch.clear();
+    scratch.reserve(line.size());
+    const char* p = line.data();
+    const char* end = p + line.size();
+    while(out.size()<limit){
+        const char* f = p;
+        const char* d = csv_find_delim(p, end);
+        if(d==end || *d==','){                      // plain field
+            out.emplace_back(f, (size_t)(d-f));
+            if(d==end) return;
+            p = d+1;
+            continue;
+        }
+        // field with quotes: rebuild into scratch
+        size_t start = scratch.size();
+        scratch.append(f, (size_t)(d-f));
+        bool inq = false;
+        const char* q = d;
+        while(q<end){
+            char ch = *q;
+            if(inq){
+                const char* nq = csv_find_quote(q, end);
+                scratch.append(q, (size_t)(nq-q));
+                q = nq;
+                if(q==end) break;
+                if(q+1<end && q[1]=='"'){ scratch.push_back('"'); q += 2; }
+                else { inq=false; ++q; }
+            }else if(ch=='"'){ inq=true; ++q; }
+            else if(ch==','){ break; }
+            else{
+                const char* nd = csv_find_delim(q, end);
+                scratch.append(q, (size_t)(nd-q));
+                q = nd;
+            }
+        }
+        out.emplace_back(scratch.data()+start, scratch.size()-start);
+        if(q==end) return;
+        p = q+1;
+    }
+}
+// Strip spaces, tabs, CR/LF and stray quote characters from both ends
+static inline std::string_view csv_trim_view(std::string_view s){
+    const char* ws = " \t\r\n\"'";
+    size_t a = s.find_first_not_of(ws);
+    if(a==std::string_view::npos) return {};
+    size_t b = s.find_last_not_of(ws);
+    return s.substr(a, b-a+1);
+}
+// Number from a (trimmed) field; NaN when it does not start with one
+static inline double csv_to_double(std::string_view s){
+    if(!s.empty() && s[0]=='+') s.remove_prefix(1);
+    double v = NAN;
+    auto r = std::from_chars(s.data(), s.data()+s.size(), v);
+    if(r.ec!=std::errc()) return NAN;
+    return v;
+}
+
+// Write a field, quoting only when it holds a comma, quote or line break
+static inline void csv_write_field(std::ostream& out, std::string_view s){
+    if(s.find_first_of(",\"\r\n")==std::string_view::npos){ out<<s; return; }
+    out<<'"';
+    for(char c: s){ if(c=='"') out<<'"'; out<<c; }
+    out<<'"';
+}
+
+// Same, appended to a string buffer
+static inline void csv_append_field(std::string& out, std::string_view s){
+    if(s.find_first_of(",\"\r\n")==std::string_view::npos){ out.append(s); return; }
+    out.push_back('"');
+    for(char c: s){ if(c=='"') out.push_back('"'); out.push_back(c); }
+    out.push_back('"');
+}
+
+// Drop a UTF-8 BOM and control characters other than tab
+static inline std::string strip_invisible(std::string s){
+    std::string out; out.reserve(s.size());
+    for (size_t i=0;i<s.size();++i){
+        unsigned char c=(unsigned char)s[i];
+        if (c==0xEF && i+2<s.size() && (unsigned char)s[i+1]==0xBB && (unsigned char)s[i+2]==0xBF){ i+=2; continue; }
+        if (c<32 && c!='\t' && c!=' ') continue;
+        out.push_back((char)c);
+    }
+    return out;
+}
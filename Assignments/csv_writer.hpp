@@ -0,0 +1,114 @@
+#pragma once
+// Buffered CSV writer for finalcode.cpp.
+// Rows are formatted into one reusable buffer and handed to an unbuffered C
+// stream in large blocks, so a file costs a handful of writes. Fields are quoted
+// only when they hold a comma, quote or line break; numbers go through
+// std::to_chars (shortest round-trip, or rounded to a tick precision).
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <cmath>
+#include <charconv>
+#include <system_error>
+
+#include "csv_tokenizer.hpp"
+
+// ───────────────────────────── numbers
+// Shortest text that reads back as exactly v; nothing for NaN
+static inline void csv_append_shortest(std::string& out, double v){
+    if(std::isnan(v)) return;
+    char buf[32];
+    auto r = std::to_chars(buf, buf+sizeof buf, v);
+    out.append(buf, (size_t)(r.ptr-buf));
+}
+// v rounded to `decimals` places, trailing zeros (and a bare '.') dropped; nothing for NaN
+static inline void csv_append_tick(std::string& out, double v, int decimals){
+    if(std::isnan(v)) return;
+    char buf[400];                                   // widest fixed double plus decimals
+    auto r = std::to_chars(buf, buf+sizeof buf, v, std::chars_format::fixed, decimals);
+    if(r.ec!=std::errc()){ csv_append_shortest(out, v); return; }
+    const char* e = r.ptr;
+    if(decimals>0){
+        while(e[-1]=='0') --e;
+        if(e[-1]=='.') --e;
+    }
+    std::string_view s(buf, (size_t)(e-buf));
+    out.append(s=="-0" ? std::string_view("0") : s);
+}
+static inline void csv_append_int(std::string& out, int64_t v){
+    char buf[24];
+    auto r = std::to_chars(buf, buf+sizeof buf, v);
+    out.append(buf, (size_t)(r.ptr-buf));
+}
+static inline std::string csv_format_tick(double v, int decimals){
+    std::string s;
+    csv_append_tick(s, v, decimals);
+    return s;
+}
+
+// ───────────────────────────── writer
+// open() / fields / end_row() / close(). The buffer is kept across files, so a
+// writer reused by one thread stops allocating after the first large table.
+class CsvWriter{
+public:
+    static constexpr size_t BLOCK = 1<<16;
+
+    CsvWriter() = default;
+    CsvWriter(const CsvWriter&) = delete;
+    CsvWriter& operator=(const CsvWriter&) = delete;
+    ~CsvWriter(){ close(); }
+
+    bool open(const std::string& path){
+        close();
+        f_ = std::fopen(path.c_str(), "w");
+        if(!f_) return false;
+        std::setvbuf(f_, nullptr, _IONBF, 0);
+        buf_.clear(); first_=true; ok_=true;
+        return true;
+    }
+    // Flush and close; false when any write failed
+    bool close(){
+        if(!f_) return ok_;
+        flush();
+        if(std::fclose(f_)!=0) ok_=false;
+        f_=nullptr;
+        return ok_;
+    }
+
+    void blank_rows(int n){
+        if(n>0) buf_.append((size_t)n, '\n');
+        spill();
+    }
+    void field(std::string_view s){ sep(); csv_append_field(buf_, s); }
+    void number(double v){ sep(); csv_append_shortest(buf_, v); }
+    void number(double v, int decimals){ sep(); csv_append_tick(buf_, v, decimals); }
+    void integer(int64_t v){ sep(); csv_append_int(buf_, v); }
+    void end_row(){
+        buf_.push_back('\n');
+        first_=true;
+        spill();
+    }
+    void row(const std::vector<std::string>& r){
+        for(const auto& c: r) field(c);
+        end_row();
+    }
+    // Exactly `width` fields: missing cells are written empty, extra ones dropped
+    void row(const std::vector<std::string>& r, size_t width){
+        for(size_t k=0;k<width;++k) field(k<r.size() ? std::string_view(r[k]) : std::string_view());
+        end_row();
+    }
+
+private:
+    void sep(){ if(!first_) buf_.push_back(','); first_=false; }
+    void spill(){ if(buf_.size()>=BLOCK) flush(); }
+    void flush(){
+        if(!buf_.empty() && std::fwrite(buf_.data(), 1, buf_.size(), f_)!=buf_.size()) ok_=false;
+        buf_.clear();
+    }
+
+    std::FILE* f_ = nullptr;
+    std::string buf_;
+    bool first_ = true, ok_ = true;
+};
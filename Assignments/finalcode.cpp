@@ -13,6 +13,35 @@
 #include <limits>
 #include <unordered_set>
 #include <unordered_map>
+#include <map>
+#include <queue>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <cstdint>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+#include <thread>
+#include <chrono>
+#include <csignal>
+
+#include "csv_tokenizer.hpp"
+#include "trigger_extract.hpp"
+#include "csv_writer.hpp"
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
 
 namespace fs = std::filesystem;
 
@@ -21,6 +50,64 @@ static constexpr int    MAX_ATTEMPTS       = 12;
 static constexpr double SLIPPAGE           = 0.5;
 static constexpr double EPS                = 1e-9;
 static constexpr int    OUTPUT_ROW_OFFSET  = 20; // number of blank rows before header
+static constexpr int    PRICE_DECIMALS     = 6;  // fills and P/L: rounded to this many places, trailing zeros dropped
+
+// Blank rows written above each output header (--row-offset); OUTPUT_ROW_OFFSET unless changed
+static int g_row_offset = OUTPUT_ROW_OFFSET;
+
+// ───────────────────────────── worker pool
+// Console lines written from worker threads go through one lock so they do not interleave
+static std::mutex g_log_mutex;
+static void log_line(std::ostream& os, const std::string& s){
+    std::lock_guard<std::mutex> lk(g_log_mutex);
+    os<<s;
+}
+// Runs fn(i) for every i in [0,n) on `threads` workers (0 = one per core).
+// Each worker owns a deque seeded with a contiguous block of indices; it pops
+// from the back of its own and, once empty, steals from the front of the
+// others. fn must only write state owned by index i. The first exception is
+// rethrown after all workers finish.
+static void parallel_for(size_t n, unsigned threads, const std::function<void(size_t)>& fn){
+    if(threads==0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = (unsigned)std::min<size_t>(threads, n);
+    if(threads<=1){
+        for(size_t i=0;i<n;++i) fn(i);
+        return;
+    }
+    struct Queue{ std::mutex m; std::deque<size_t> q; };
+    std::vector<Queue> qs(threads);
+    for(unsigned w=0;w<threads;++w)
+        for(size_t i=n*w/threads;i<n*(w+1)/threads;++i) qs[w].q.push_back(i);
+
+    auto take=[&](unsigned w, size_t& i)->bool{
+        {
+            std::lock_guard<std::mutex> lk(qs[w].m);
+            if(!qs[w].q.empty()){ i=qs[w].q.back(); qs[w].q.pop_back(); return true; }
+        }
+        for(unsigned k=1;k<threads;++k){
+            Queue& v = qs[(w+k)%threads];
+            std::lock_guard<std::mutex> lk(v.m);
+            if(!v.q.empty()){ i=v.q.front(); v.q.pop_front(); return true; }
+        }
+        return false;
+    };
+    std::exception_ptr err;
+    std::mutex errm;
+    std::vector<std::thread> pool;
+    for(unsigned w=0;w<threads;++w)
+        pool.emplace_back([&, w]{
+            size_t i;
+            while(take(w, i)){
+                try{ fn(i); }
+                catch(...){
+                    std::lock_guard<std::mutex> lk(errm);
+                    if(!err) err=std::current_exception();
+                }
+            }
+        });
+    for(auto& t: pool) t.join();
+    if(err) std::rethrow_exception(err);
+}
 
 // ───────────────────────────── utils
 static inline std::string trim(const std::string& s){
@@ -39,16 +126,6 @@ static inline std::string norm_alnum(const std::string& s){
         if (std::isalnum(ch)) o.push_back((char)std::tolower(ch));
     return o;
 }
-static inline std::string strip_invisible(std::string s){
-    std::string out; out.reserve(s.size());
-    for (size_t i=0;i<s.size();++i){
-        unsigned char c=(unsigned char)s[i];
-        if (c==0xEF && i+2<s.size() && (unsigned char)s[i+1]==0xBB && (unsigned char)s[i+2]==0xBF){ i+=2; continue; }
-        if (c<32 && c!='\t' && c!=' ') continue;
-        out.push_back((char)c);
-    }
-    return out;
-}
 static inline bool starts_with_ci_after_trim_ohlcv(const std::string& raw){
     std::string h = strip_invisible(raw);
     size_t i=0;
@@ -57,81 +134,94 @@ static inline bool starts_with_ci_after_trim_ohlcv(const std::string& raw){
     return tail.rfind("ohlcv ",0)==0;
 }
 
-// Read first non-empty (non-whitespace) line, return false on EOF
-static bool getline_nonempty(std::istream& in, std::string& line){
-    while (std::getline(in, line)){
-        bool any = false;
-        for(char c : line){
-            if(c!=' ' && c!='\t' && c!='\r' && c!='\n'){
-                any = true;
-                break;
-            }
-        }
-        if(any) return true;
+// Trimmed fields of one line into `out`, reusing its vector and cell buffers
+static inline void splitCSV_into(std::string_view line, std::vector<std::string>& out){
+    thread_local std::vector<std::string_view> f;
+    thread_local std::string scratch;
+    csv_split_views(line, f, scratch);
+    out.resize(f.size());
+    for(size_t k=0;k<f.size();++k){
+        std::string_view v = csv_trim_view(f[k]);
+        out[k].assign(v.data(), v.size());
     }
-    return false;
+}
+static inline std::vector<std::string> splitCSV(std::string_view line){
+    std::vector<std::string> out;
+    splitCSV_into(line, out);
+    return out;
 }
 
-static inline std::vector<std::string> splitCSV(const std::string& line){
-    std::vector<std::string> out; std::string cur; bool inq=false;
-    for(size_t i=0;i<line.size();++i){
-        char ch=line[i];
-        if(inq){
-            if(ch=='"'){
-                if(i+1<line.size() && line[i+1]=='"'){ cur.push_back('"'); ++i; }
-                else inq=false;
-            } else cur.push_back(ch);
-        }else{
-            if(ch=='"') inq=true;
-            else if(ch==','){ out.push_back(trim(cur)); cur.clear(); }
-            else cur.push_back(ch);
+// ───────────────────────────── row pool (per worker thread)
+// Rows (one vector of cells each) are most of what merging and resolving a
+// trigger allocates. A finished table gives its rows back to the pool of the
+// thread that drops it; the next table takes them out again and overwrites the
+// cells in place, so row vectors and cell buffers keep their capacity from one
+// trigger to the next instead of going back to malloc.
+using Row  = std::vector<std::string>;
+using Rows = std::vector<Row>;
+struct RowPool{
+    static constexpr size_t MAX_ROWS = 1<<16;    // rows kept per thread
+    Rows free;
+    Row take(){
+        if(free.empty()) return Row();
+        Row r = std::move(free.back());
+        free.pop_back();
+        return r;
+    }
+    void give(Rows& rows){
+        for(auto& r: rows){
+            if(free.size()>=MAX_ROWS) break;
+            free.push_back(std::move(r));
         }
+        rows.clear();
     }
-    out.push_back(trim(cur));
-    return out;
+};
+static RowPool& row_pool(){
+    thread_local RowPool pool;
+    return pool;
+}
+// A pooled row holding the trimmed fields of `line`
+static inline Row split_pooled(std::string_view line){
+    Row r = row_pool().take();
+    splitCSV_into(line, r);
+    return r;
 }
 static inline double safe_stod(const std::string& s){
-    try { return std::stod(s); } catch (...) { return NAN; }
+    const char* b=s.c_str(); char* end=nullptr;
+    errno=0;
+    double v=std::strtod(b, &end);
+    if(end==b || errno==ERANGE) return NAN;
+    return v;
 }
 
-static void writeCSV_raw(const std::string& filename,
-                         const std::vector<std::string>& headers,
-                         const std::vector<std::vector<std::string>>& rows){
-    std::ofstream out(filename);
-    if(!out){
-        std::cerr<<"❌ Cannot open "<<filename<<"\n";
-        return;
-    }
-
-    auto quote=[&](const std::string& s){
-        std::string t=s;
-        for(size_t pos=0;(pos=t.find('"',pos))!=std::string::npos;pos+=2)
-            t.insert(pos,"\"");
-        return "\""+t+"\"";
-    };
-
-    // Push everything down by OUTPUT_ROW_OFFSET rows
-    for(int i = 0; i < OUTPUT_ROW_OFFSET; ++i){
-        out << "\n";
-    }
+static std::string format_price(double v){ return csv_format_tick(v, PRICE_DECIMALS); }
 
-    // header row
-    for(size_t i=0;i<headers.size();++i){
-        out<<quote(headers[i]);
-        if(i+1<headers.size()) out<<",";
+// Output table: g_row_offset blank rows, then header and rows. Cells are quoted only
+// when needed. With fit, every row is written with exactly the header's width.
+static void write_table(const std::string& filename,
+                        const std::vector<std::string>& headers,
+                        const std::vector<std::vector<std::string>>& rows, bool fit){
+    thread_local CsvWriter out;                  // buffer reused by every table this thread writes
+    if(!out.open(filename)){
+        log_line(std::cerr, "❌ Cannot open "+filename+"\n");
+        return;
     }
-    out<<"\n";
-
-    // data rows
+    out.blank_rows(g_row_offset);
+    out.row(headers);
     for(const auto& r: rows){
-        for(size_t i=0;i<r.size();++i){
-            out<<quote(r[i]);
-            if(i+1<r.size()) out<<",";
-        }
-        out<<"\n";
+        if(fit) out.row(r, headers.size());
+        else    out.row(r);
     }
-
-    std::cout<<"✅ Wrote "<<rows.size()<<" rows → "<<filename<<"\n";
+    if(!out.close()){
+        log_line(std::cerr, "❌ Write failed: "+filename+"\n");
+        return;
+    }
+    log_line(std::cout, "✅ Wrote "+std::to_string(rows.size())+" rows → "+filename+"\n");
+}
+static void writeCSV_raw(const std::string& filename,
+                         const std::vector<std::string>& headers,
+                         const std::vector<std::vector<std::string>>& rows){
+    write_table(filename, headers, rows, false);
 }
 
 static int findColByNames(const std::vector<std::string>& H, const std::vector<std::string>& cands){
@@ -164,60 +254,111 @@ static int findColPL_Tight(const std::vector<std::string>& H){
     return -1;
 }
 
-// ───────────────────────────── ET time helpers
-static inline std::time_t timegm_compat(std::tm* t){
-#ifdef _WIN32
-    return _mkgmtime(t);
-#else
-    return timegm(t);
-#endif
+// ───────────────────────────── civil time arithmetic
+// Days since 1970-01-01 for a proleptic Gregorian date, and back (H. Hinnant)
+static inline int64_t days_from_civil(int64_t y, unsigned m, unsigned d){
+    y -= m<=2;
+    const int64_t era = (y>=0 ? y : y-399) / 400;
+    const unsigned yoe = (unsigned)(y - era*400);
+    const unsigned doy = (153*(m>2 ? m-3 : m+9) + 2)/5 + d-1;
+    const unsigned doe = yoe*365 + yoe/4 - yoe/100 + doy;
+    return era*146097 + (int64_t)doe - 719468;
 }
-static bool parse_flex_ts(const std::string& s, std::tm& t){
-    std::string x=trim(s); int Y=0,M=0,D=0,h=0,m=0,sec=0; int n=0;
-    n=std::sscanf(x.c_str(), "%d/%d/%d %d:%d:%d", &M,&D,&Y,&h,&m,&sec);
-    if(n<5){
-        n=std::sscanf(x.c_str(), "%d/%d/%d %d:%d", &M,&D,&Y,&h,&m);
-        if(n>=5) sec=0;
-    }
-    if(n>=5 && M>0 && D>0 && Y>0){
-        t={};
-        t.tm_year=Y-1900; t.tm_mon=M-1; t.tm_mday=D;
-        t.tm_hour=h; t.tm_min=m; t.tm_sec=sec; t.tm_isdst=-1;
-        return true;
-    }
-    n=std::sscanf(x.c_str(), "%d-%d-%d %d:%d:%d", &Y,&M,&D,&h,&m,&sec);
-    if(n<5){
-        n=std::sscanf(x.c_str(), "%d-%d-%d %d:%d", &Y,&M,&D,&h,&m);
-        if(n>=5) sec=0;
-    }
-    if(n>=5 && M>0 && D>0 && Y>0){
-        t={};
-        t.tm_year=Y-1900; t.tm_mon=M-1; t.tm_mday=D;
-        t.tm_hour=h; t.tm_min=m; t.tm_sec=sec; t.tm_isdst=-1;
+static inline void civil_from_days(int64_t z, int& y, int& m, int& d){
+    z += 719468;
+    const int64_t era = (z>=0 ? z : z-146096) / 146097;
+    const unsigned doe = (unsigned)(z - era*146097);
+    const unsigned yoe = (doe - doe/1460 + doe/36524 - doe/146096) / 365;
+    const unsigned doy = doe - (365*yoe + yoe/4 - yoe/100);
+    const unsigned mp  = (5*doy + 2)/153;
+    d = (int)(doy - (153*mp+2)/5 + 1);
+    m = (int)(mp<10 ? mp+3 : mp-9);
+    y = (int)(yoe + era*400 + (m<=2));
+}
+// Seconds since the epoch for a wall-clock reading; out-of-range fields carry over like timegm
+static inline int64_t civil_seconds(int64_t Y, int64_t M, int64_t D, int64_t h, int64_t m, int64_t s){
+    int64_t m0 = M-1;
+    Y += (m0>=0 ? m0 : m0-11)/12;
+    m0 -= ((m0>=0 ? m0 : m0-11)/12)*12;
+    return (days_from_civil(Y, (unsigned)(m0+1), 1) + D-1)*86400 + h*3600 + m*60 + s;
+}
+static inline int64_t wall_seconds(const std::tm& t){
+    return civil_seconds(t.tm_year+1900, t.tm_mon+1, t.tm_mday, t.tm_hour, t.tm_min, t.tm_sec);
+}
+
+// ───────────────────────────── ET time helpers
+// A timestamp cell: wall-clock seconds as written, and whether it ended in Z (UTC)
+struct TsCell{ int64_t wall=0; bool utc=false; };
+
+// M/D/Y or Y-M-D, then H:MM[:SS] after spaces or 'T'; fractional seconds are dropped
+// and a trailing 'Z' marks UTC. Fields read like sscanf("%d"), so "9:5" or "+9" still parse.
+static bool parse_ts_cell(std::string_view x, TsCell& out){
+    x = csv_trim_view(x);
+    const char* p = x.data();
+    const char* end = p + x.size();
+    auto skip_ws=[&]{ while(p<end && (*p==' ' || *p=='\t' || *p=='\r' || *p=='\n')) ++p; };
+    auto num=[&](int64_t& v)->bool{
+        skip_ws();
+        bool neg=false;
+        if(p<end && (*p=='+' || *p=='-')){ neg=(*p=='-'); ++p; }
+        if(p>=end || *p<'0' || *p>'9') return false;
+        int64_t r=0;
+        while(p<end && *p>='0' && *p<='9' && r<100000000) r = r*10 + (*p++ - '0');
+        v = neg ? -r : r;
         return true;
-    }
-    return false;
+    };
+    auto lit=[&](char c)->bool{ if(p<end && *p==c){ ++p; return true; } return false; };
+
+    int64_t a=0, b=0, c=0, h=0, mi=0, sec=0;
+    if(!num(a)) return false;
+    char dsep = (p<end && (*p=='/' || *p=='-')) ? *p : 0;
+    if(!dsep || !lit(dsep) || !num(b) || !lit(dsep) || !num(c)) return false;
+    int64_t Y = dsep=='/' ? c : a, M = dsep=='/' ? a : b, D = dsep=='/' ? b : c;
+    if(p<end && *p=='T') ++p;
+    if(!num(h) || !lit(':') || !num(mi)) return false;
+    if(lit(':') && num(sec) && lit('.')) while(p<end && *p>='0' && *p<='9') ++p;
+    if(M<=0 || D<=0 || Y<=0) return false;
+    out.wall = civil_seconds(Y, M, D, h, mi, sec);
+    out.utc  = (p<end && *p=='Z');
+    return true;
 }
-static inline std::time_t utc_to_et(std::time_t utc){
-    std::tm* g=std::gmtime(&utc);
-    int Y=g->tm_year+1900;
-    auto nth=[&](int month,int weekday,int n){
-        std::tm tm0{}; tm0.tm_year=Y-1900; tm0.tm_mon=month-1; tm0.tm_mday=1;
-        std::time_t t0=timegm_compat(&tm0);
-        std::tm g0=*gmtime(&t0);
-        int first=g0.tm_wday; int delta=(weekday-first+7)%7;
-        return 1+delta+7*(n-1);
+
+// US Eastern DST for year Y, as UTC seconds: 2nd Sunday of March 07:00 to 1st Sunday of November 06:00
+struct DstSpan{ int64_t start, end; };
+static DstSpan dst_span_for_year(int Y){
+    auto nth_sunday=[&](unsigned month, int n){
+        int64_t first = days_from_civil(Y, month, 1);
+        int wday = (int)(((first % 7) + 11) % 7);        // 1970-01-01 was a Thursday; 0 = Sunday
+        return first + (7-wday)%7 + 7*(n-1);
     };
-    std::tm S{}; S.tm_year=Y-1900; S.tm_mon=2; S.tm_mday=nth(3,0,2); S.tm_hour=7;
-    std::tm E{}; E.tm_year=Y-1900; E.tm_mon=10;E.tm_mday=nth(11,0,1); E.tm_hour=6;
-    std::time_t s=timegm_compat(&S), e=timegm_compat(&E);
-    bool dst = (utc>=s && utc<e);
+    return { nth_sunday(3,2)*86400 + 7*3600, nth_sunday(11,1)*86400 + 6*3600 };
+}
+static constexpr int DST_TABLE_FIRST = 1970, DST_TABLE_LAST = 2100;
+static inline DstSpan dst_span(int Y){
+    static const std::vector<DstSpan> table = []{
+        std::vector<DstSpan> t;
+        for(int y=DST_TABLE_FIRST; y<=DST_TABLE_LAST; ++y) t.push_back(dst_span_for_year(y));
+        return t;
+    }();
+    if(Y<DST_TABLE_FIRST || Y>DST_TABLE_LAST) return dst_span_for_year(Y);
+    return table[(size_t)(Y-DST_TABLE_FIRST)];
+}
+static inline std::time_t utc_to_et(std::time_t utc){
+    int64_t days = ((int64_t)utc>=0 ? (int64_t)utc : (int64_t)utc-86399)/86400;
+    int Y,M,D; civil_from_days(days, Y, M, D);
+    DstSpan s = dst_span(Y);
+    bool dst = (utc>=s.start && utc<s.end);
     return utc + (dst?-4:-5)*3600;
 }
+static inline std::time_t et_epoch_from_wall(int64_t et_wall){
+    return utc_to_et((std::time_t)(et_wall + 5*3600));
+}
 static inline std::time_t et_epoch_from_et_tm(const std::tm& et){
-    std::tm t5=et; t5.tm_isdst=-1; t5.tm_hour+=5;
-    std::time_t utc=timegm_compat(&t5);
-    return utc_to_et(utc);
+    return et_epoch_from_wall(wall_seconds(et));
+}
+// Sort/search key of a cell; UTC ('Z') readings are first moved to Eastern wall time
+static inline std::time_t et_epoch_of(const TsCell& c){
+    return et_epoch_from_wall(c.utc ? (int64_t)utc_to_et((std::time_t)c.wall) : c.wall);
 }
 static bool trade_time_from_filename_ET(const std::string& path,std::time_t& base_et){
     std::string f=fs::path(path).filename().string();
@@ -241,9 +382,9 @@ static bool last_et_timestamp_in_csv(const std::string& file,std::time_t& last,s
         auto cols=splitCSV(line);
         for(const auto& c: cols){
             if((c.find('/')==std::string::npos && c.find('-')==std::string::npos) || c.find(':')==std::string::npos) continue;
-            std::tm t{};
-            if(!parse_flex_ts(c,t)) continue;
-            std::time_t loc=et_epoch_from_et_tm(t);
+            TsCell t;
+            if(!parse_ts_cell(c,t)) continue;
+            std::time_t loc=et_epoch_of(t);
             if(!found || loc>best){
                 found=true; best=loc; bests=trim(c);
             }
@@ -254,6 +395,656 @@ static bool last_et_timestamp_in_csv(const std::string& file,std::time_t& last,s
     last=best; out=bests; return true;
 }
 
+// ───────────────────────────── columnar bar table
+// Repeating text cells (symbol, instrument, publisher, rtype) stored once; id 0 = ""
+struct StringPool{
+    std::vector<std::string> strs{""};
+    std::unordered_map<std::string,uint32_t> ids{{"",0}};
+    uint32_t intern(const std::string& s){
+        auto it=ids.find(s);
+        if(it!=ids.end()) return it->second;
+        strs.push_back(s);
+        return ids[s]=(uint32_t)(strs.size()-1);
+    }
+};
+// How a wall-clock time is written (trade tables use the default, "YYYY-MM-DD HH:MM:SS")
+struct TsLayout{ bool mdy=false, pad=true, secs=true, utc=false; char sep=' '; };
+// Appends to `out`; same text as "%02d/%02d/%04d %02d:%02d:%02d" and friends, without printf
+static void format_wall_into(std::string& out, int64_t wall, const TsLayout& L){
+    int64_t days = (wall>=0 ? wall : wall-86399)/86400, sod = wall - days*86400;
+    int Y,M,D; civil_from_days(days, Y, M, D);
+    int h=(int)(sod/3600), m=(int)(sod/60%60), sec=(int)(sod%60);
+    auto num=[&](int v, int width){
+        char buf[16];
+        char* e = std::to_chars(buf, buf+sizeof buf, v).ptr;
+        for(int k=(int)(e-buf); k<width; ++k) out.push_back('0');
+        out.append(buf, e);
+    };
+    const int w = L.pad ? 2 : 1;
+    if(L.mdy){ num(M, w); out.push_back('/'); num(D, w); out.push_back('/'); num(Y, 4); }
+    else     { num(Y, 4); out.push_back('-'); num(M, w); out.push_back('-'); num(D, w); }
+    out.push_back(L.sep);
+    num(h, w); out.push_back(':'); num(m, 2);
+    if(L.secs){ out.push_back(':'); num(sec, 2); }
+    if(L.utc) out.push_back('Z');
+}
+static std::string format_wall(int64_t wall, const TsLayout& L){
+    std::string out;
+    out.reserve(24);
+    format_wall_into(out, wall, L);
+    return out;
+}
+
+// Typed OHLCV columns, one entry per bar; prices print rounded to the most decimals their column was
+// written with, trailing zeros dropped. The time cell and any column without a role are kept as their
+// source text, so those cells are written back exactly as the file had them.
+static constexpr int64_t VOLUME_NONE = std::numeric_limits<int64_t>::min();
+struct BarTable{
+    int decimals[4] = {0,0,0,0};       // open, high, low, close
+    StringPool pool;
+    std::vector<int64_t>  ts;          // ET epoch (sort + search key)
+    uint32_t nText = 1;                // text cells per bar (time column first, then untyped columns)
+    std::string text;                  // text cells of every bar, back to back
+    std::vector<uint64_t> textEnd;     // end offset in `text` of each cell (nText per bar)
+    std::vector<double>   open, high, low, close;   // NaN when blank
+    std::vector<int64_t>  volume;      // VOLUME_NONE when blank
+    std::vector<uint32_t> rtype, publisher, instrument, symbol;   // StringPool ids
+    size_t size() const { return ts.size(); }
+    std::string_view text_cell(size_t i, size_t j) const {
+        const size_t c = i*nText + j;
+        const uint64_t b = c ? textEnd[c-1] : 0;
+        return std::string_view(text.data()+b, (size_t)(textEnd[c]-b));
+    }
+    void push_text(std::string_view s){ text.append(s.data(), s.size()); textEnd.push_back(text.size()); }
+};
+
+// ───────────────────────────── first-crossing kernels
+// First i in [from,to) with v[i] >= x (GE) or v[i] <= x (LE); `to` when none.
+// Compares are ordered, so NaN never qualifies. AVX builds test 8 doubles per
+// step, SSE2 builds 4; anything else runs the scalar loop, which is also the
+// reference the vector paths are checked against (OJ_VERIFY_KERNELS).
+enum class Cmp : unsigned char { GE, LE };
+template<Cmp C> static inline bool cmp_hit(double v, double x){ return C==Cmp::GE ? v>=x : v<=x; }
+template<Cmp C>
+static inline size_t first_cmp_scalar(const double* v, size_t from, size_t to, double x){
+    for(size_t i=from;i<to;++i) if(cmp_hit<C>(v[i], x)) return i;
+    return to;
+}
+template<Cmp C>
+static inline size_t first_cmp(const double* v, size_t from, size_t to, double x){
+    size_t i=from;
+#if defined(__AVX__)
+    const __m256d X=_mm256_set1_pd(x);
+    auto cmp=[&](__m256d a){ return C==Cmp::GE ? _mm256_cmp_pd(a, X, _CMP_GE_OQ) : _mm256_cmp_pd(a, X, _CMP_LE_OQ); };
+    for(; i+8<=to; i+=8){
+        __m256d m0=cmp(_mm256_loadu_pd(v+i)), m1=cmp(_mm256_loadu_pd(v+i+4));
+        if(_mm256_movemask_pd(_mm256_or_pd(m0, m1))){
+            unsigned bits=(unsigned)_mm256_movemask_pd(m0) | ((unsigned)_mm256_movemask_pd(m1)<<4);
+            return i + csv_ctz(bits);
+        }
+    }
+#elif defined(CSV_TOKENIZER_SSE2)
+    const __m128d X=_mm_set1_pd(x);
+    auto cmp=[&](__m128d a){ return C==Cmp::GE ? _mm_cmpge_pd(a, X) : _mm_cmple_pd(a, X); };
+    for(; i+4<=to; i+=4){
+        __m128d m0=cmp(_mm_loadu_pd(v+i)), m1=cmp(_mm_loadu_pd(v+i+2));
+        if(_mm_movemask_pd(_mm_or_pd(m0, m1))){
+            unsigned bits=(unsigned)_mm_movemask_pd(m0) | ((unsigned)_mm_movemask_pd(m1)<<2);
+            return i + csv_ctz(bits);
+        }
+    }
+#endif
+    return first_cmp_scalar<C>(v, i, to, x);
+}
+
+// ───────────────────────────── range extrema index (first-crossing queries)
+// Max of highs / min of lows per block of EXTREMA_BLOCK bars, plus a
+// power-of-two segment tree over the blocks. "First bar in [from,to) with
+// high >= x" is a short scan of the first block, an O(log n) walk to the first
+// qualifying block, and a scan inside it. NaN bars never qualify.
+static constexpr size_t EXTREMA_BLOCK = 32;
+struct ExtremaIndex{
+    size_t n=0, nblk=0, size=1;
+    std::vector<double> mx, mn;      // tree nodes [1, 2*size); leaves are blocks
+};
+static void build_extrema_index(const std::vector<double>& hi, const std::vector<double>& lo, ExtremaIndex& ix){
+    const double inf = std::numeric_limits<double>::infinity();
+    ix.n    = hi.size();
+    ix.nblk = (ix.n + EXTREMA_BLOCK - 1) / EXTREMA_BLOCK;
+    ix.size = 1;
+    while(ix.size < ix.nblk) ix.size <<= 1;
+    ix.mx.assign(2*ix.size, -inf);
+    ix.mn.assign(2*ix.size,  inf);
+    for(size_t i=0;i<ix.n;++i){
+        double& M = ix.mx[ix.size + i/EXTREMA_BLOCK];
+        double& m = ix.mn[ix.size + i/EXTREMA_BLOCK];
+        if(!std::isnan(hi[i]) && hi[i]>M) M=hi[i];
+        if(!std::isnan(lo[i]) && lo[i]<m) m=lo[i];
+    }
+    for(size_t v=ix.size-1; v>=1; --v){
+        ix.mx[v] = std::max(ix.mx[2*v], ix.mx[2*v+1]);
+        ix.mn[v] = std::min(ix.mn[2*v], ix.mn[2*v+1]);
+    }
+}
+// First index in [from,to) where vals[i] >= x (GE) or <= x (LE); `to` when none
+template<Cmp C>
+static size_t first_crossing(const ExtremaIndex& ix, const std::vector<double>& tree,
+                             const std::vector<double>& vals, size_t from, size_t to, double x)
+{
+    to = std::min(to, ix.n);
+    if(from>=to) return to;
+    size_t blkEnd = std::min((from/EXTREMA_BLOCK + 1)*EXTREMA_BLOCK, to);
+    size_t i = first_cmp<C>(vals.data(), from, blkEnd, x);
+    if(i<blkEnd || blkEnd>=to) return i<blkEnd ? i : to;
+
+    // climb to the first subtree right of the current block that holds a hit
+    size_t v = ix.size + blkEnd/EXTREMA_BLOCK;
+    while(!cmp_hit<C>(tree[v], x)){
+        while(v & 1) v >>= 1;
+        if(v==0) return to;
+        ++v;
+    }
+    while(v < ix.size){ v <<= 1; if(!cmp_hit<C>(tree[v], x)) ++v; }
+
+    size_t b0 = (v - ix.size)*EXTREMA_BLOCK;
+    size_t b1 = std::min(b0 + EXTREMA_BLOCK, to);
+    return first_cmp<C>(vals.data(), b0, b1, x);
+}
+
+// ───────────────────────────── OHLCV store (loaded once, time-indexed)
+enum class BarCol : unsigned char { Ts, Open, High, Low, Close, Volume, Rtype, Publisher, Instrument, Symbol, Text };
+struct OhlcvStore{
+    bool ok=false;
+    std::vector<std::string> header;  // the source header
+    std::vector<BarCol> cols;         // role of each column (Text = kept as written)
+    BarTable bars;
+    ExtremaIndex ext;                 // block max(high) / min(low)
+};
+static size_t first_high_at_or_above(const OhlcvStore& st, size_t from, size_t to, double x){
+    return first_crossing<Cmp::GE>(st.ext, st.ext.mx, st.bars.high, from, to, x);
+}
+static size_t first_low_at_or_below(const OhlcvStore& st, size_t from, size_t to, double x){
+    return first_crossing<Cmp::LE>(st.ext, st.ext.mn, st.bars.low, from, to, x);
+}
+static bool ohlcv_role(const std::string& raw, BarCol& role){
+    std::string k = norm_alnum(strip_invisible(raw));
+    if(k.rfind("ohlcv",0)==0) k.erase(0,5);
+    if(k=="tsevent"||k=="timestamp"||k=="datetime"||k=="date"||k=="time"||k=="ts"){ role=BarCol::Ts; return true; }
+    if(k=="open")   { role=BarCol::Open;   return true; }
+    if(k=="high")   { role=BarCol::High;   return true; }
+    if(k=="low")    { role=BarCol::Low;    return true; }
+    if(k=="close")  { role=BarCol::Close;  return true; }
+    if(k=="volume") { role=BarCol::Volume; return true; }
+    if(k=="rtype"||k=="type")                 { role=BarCol::Rtype;      return true; }
+    if(k=="publisherid"||k=="publisher")      { role=BarCol::Publisher;  return true; }
+    if(k=="instrumentid"||k=="instrument")    { role=BarCol::Instrument; return true; }
+    if(k=="symbol")                           { role=BarCol::Symbol;     return true; }
+    return false;
+}
+static int decimals_of(std::string_view s){
+    size_t dot=s.find('.');
+    if(dot==std::string::npos) return 0;
+    size_t e=dot+1;
+    while(e<s.size() && std::isdigit((unsigned char)s[e])) ++e;
+    return (int)(e-dot-1);
+}
+static int64_t parse_volume(std::string_view s){
+    if(s.empty()) return VOLUME_NONE;
+    int64_t v=0;
+    auto r=std::from_chars(s.data(), s.data()+s.size(), v);
+    if(r.ec==std::errc() && r.ptr==s.data()+s.size()) return v;
+    double d=csv_to_double(s);
+    return std::isnan(d) ? VOLUME_NONE : (int64_t)std::llround(d);
+}
+// Bars src[idx[0]], src[idx[1]], ... as a new table (same pool, text layout and decimals)
+static BarTable gather_bars(const BarTable& src, const std::vector<size_t>& idx){
+    BarTable b;
+    b.nText = src.nText;
+    std::copy(std::begin(src.decimals), std::end(src.decimals), std::begin(b.decimals));
+    b.pool = src.pool;
+    auto take=[&](auto& to, const auto& from){
+        to.resize(idx.size());
+        for(size_t i=0;i<idx.size();++i) to[i]=from[idx[i]];
+    };
+    take(b.ts, src.ts);
+    b.textEnd.reserve(idx.size()*b.nText);
+    for(size_t i: idx) for(size_t j=0;j<b.nText;++j) b.push_text(src.text_cell(i, j));
+    take(b.open, src.open); take(b.high, src.high); take(b.low, src.low); take(b.close, src.close);
+    take(b.volume, src.volume);
+    take(b.rtype, src.rtype); take(b.publisher, src.publisher);
+    take(b.instrument, src.instrument); take(b.symbol, src.symbol);
+    return b;
+}
+// Bar i becomes old bar perm[i]; bars not listed in perm are dropped
+static void reorder_bars(BarTable& b, const std::vector<size_t>& perm){
+    b = gather_bars(b, perm);
+}
+// Bars parsed from one record-aligned slice of the file (own string pool)
+struct BarChunk{
+    BarTable bars;
+    bool sorted=true;
+};
+static void parse_bar_chunk(std::string_view buf, const std::vector<BarCol>& cols, const std::vector<int>& src,
+                            BarChunk& out)
+{
+    BarTable& b = out.bars;
+    b.nText = (uint32_t)std::count_if(cols.begin(), cols.end(), [](BarCol r){ return r==BarCol::Ts || r==BarCol::Text; });
+    std::vector<std::string_view> c;
+    std::string scratch;
+    std::string last_txt[4];                     // interning fast path: repeats of the previous cell
+    uint32_t last_id[4]={0,0,0,0};
+    size_t pos=0;
+    std::string_view line;
+    while(csv_next_record(buf, pos, line)){
+        csv_split_views(line, c, scratch);
+        int64_t et=0;
+        double px[4]={NAN,NAN,NAN,NAN};
+        int64_t vol=VOLUME_NONE;
+        uint32_t ids[4]={0,0,0,0};
+        bool have_ts=false;
+        const size_t textMark = b.text.size(), endMark = b.textEnd.size();
+        for(size_t k=0;k<cols.size();++k){
+            const std::string_view raw = src[k]<(int)c.size() ? c[src[k]] : std::string_view();
+            if(cols[k]==BarCol::Ts || cols[k]==BarCol::Text) b.push_text(raw);
+            if(src[k]>=(int)c.size()) continue;
+            std::string_view v=csv_trim_view(raw);
+            switch(cols[k]){
+            case BarCol::Text: break;
+            case BarCol::Ts: {
+                TsCell t;
+                if(!parse_ts_cell(v, t)) break;
+                et=et_epoch_of(t); have_ts=true;
+                break;
+            }
+            case BarCol::Open: case BarCol::High: case BarCol::Low: case BarCol::Close: {
+                int j=(int)cols[k]-(int)BarCol::Open;
+                px[j]=csv_to_double(v);
+                if(!std::isnan(px[j])) b.decimals[j]=std::max(b.decimals[j], decimals_of(v));
+                break;
+            }
+            case BarCol::Volume: vol=parse_volume(v); break;
+            case BarCol::Rtype: case BarCol::Publisher: case BarCol::Instrument: case BarCol::Symbol: {
+                int j=(int)cols[k]-(int)BarCol::Rtype;
+                if(v!=last_txt[j]){ last_txt[j].assign(v.data(), v.size()); last_id[j]=b.pool.intern(last_txt[j]); }
+                ids[j]=last_id[j];
+                break;
+            }
+            }
+        }
+        if(!have_ts){ b.text.resize(textMark); b.textEnd.resize(endMark); continue; }
+        if(!b.ts.empty() && et<b.ts.back()) out.sorted=false;
+        b.ts.push_back(et);
+        b.open.push_back(px[0]); b.high.push_back(px[1]); b.low.push_back(px[2]); b.close.push_back(px[3]);
+        b.volume.push_back(vol);
+        b.rtype.push_back(ids[0]); b.publisher.push_back(ids[1]);
+        b.instrument.push_back(ids[2]); b.symbol.push_back(ids[3]);
+    }
+}
+// Append chunk tables in file order; string ids are remapped into dst's pool
+static void stitch_bar_chunks(std::vector<BarChunk>& chunks, BarTable& dst, bool& sorted){
+    size_t total=0;
+    for(const auto& ch: chunks) total+=ch.bars.size();
+    auto reserve_all=[&](auto&... v){ (v.reserve(total), ...); };
+    reserve_all(dst.ts, dst.open, dst.high, dst.low, dst.close, dst.volume,
+                dst.rtype, dst.publisher, dst.instrument, dst.symbol);
+    sorted=true;
+    for(auto& ch: chunks){
+        BarTable& b=ch.bars;
+        if(b.size()==0) continue;
+        dst.nText = b.nText;
+        for(int j=0;j<4;++j) dst.decimals[j]=std::max(dst.decimals[j], b.decimals[j]);
+        if(!ch.sorted || (!dst.ts.empty() && b.ts.front()<dst.ts.back())) sorted=false;
+
+        std::vector<uint32_t> remap(b.pool.strs.size());
+        for(size_t id=0;id<remap.size();++id) remap[id]=dst.pool.intern(b.pool.strs[id]);
+        auto append=[](auto& to, const auto& from){ to.insert(to.end(), from.begin(), from.end()); };
+        auto append_ids=[&](std::vector<uint32_t>& to, const std::vector<uint32_t>& from){
+            for(uint32_t id: from) to.push_back(remap[id]);
+        };
+        append(dst.ts, b.ts);
+        const uint64_t base = dst.text.size();
+        dst.text.append(b.text);
+        for(uint64_t e: b.textEnd) dst.textEnd.push_back(base+e);
+        append(dst.open, b.open); append(dst.high, b.high); append(dst.low, b.low); append(dst.close, b.close);
+        append(dst.volume, b.volume);
+        append_ids(dst.rtype, b.rtype); append_ids(dst.publisher, b.publisher);
+        append_ids(dst.instrument, b.instrument); append_ids(dst.symbol, b.symbol);
+        b = BarTable{};
+    }
+}
+// Roles of an OHLCV header's columns: the last column of each role is typed,
+// every other column is kept as text; a file without a time header uses column 0.
+// src[k] is the file column of cols[k].
+static void ohlcv_columns(std::string_view hdr, OhlcvStore& st, std::vector<int>& src){
+    st.header = splitCSV(hdr);
+    src.clear();
+    int last[(int)BarCol::Text];
+    std::fill(std::begin(last), std::end(last), -1);
+    for(int i=0;i<(int)st.header.size();++i){
+        BarCol r;
+        st.cols.push_back(BarCol::Text); src.push_back(i);
+        if(ohlcv_role(st.header[i], r)) last[(int)r]=i;
+    }
+    for(int r=0;r<(int)BarCol::Text;++r) if(last[r]>=0) st.cols[last[r]]=(BarCol)r;
+    if(last[(int)BarCol::Ts]<0 && !st.cols.empty()) st.cols[0]=BarCol::Ts;
+}
+// Parse the CSV into header/cols/bars (sorted by ts). threads = 0 uses every core; small files parse on one.
+// With `parsed_end`, a trailing partial line is left alone and the offset after the last full line is returned.
+static bool parse_ohlcv_csv(const std::string& path, OhlcvStore& st, unsigned threads,
+                            std::vector<int>* src_out=nullptr, size_t* parsed_end=nullptr){
+    st = OhlcvStore{};
+    MappedFile mf;
+    if(!mf.open(path)){ std::cerr<<"❌ OHLCV missing\n"; return false; }
+    const std::string_view buf = mf.view();
+    size_t pos=0;
+    std::string_view hdr;
+    if(!csv_next_nonempty_line(buf, pos, hdr)){ std::cerr<<"❌ OHLCV empty\n"; return false; }
+    std::vector<int> src;
+    ohlcv_columns(hdr, st, src);
+
+    // newline-aligned chunks parsed in parallel, stitched back in file order
+    if(threads==0) threads = std::max(1u, std::thread::hardware_concurrency());
+    std::string_view data = buf.substr(pos);
+    if(parsed_end){
+        size_t nl = data.rfind('\n');
+        data = data.substr(0, nl==std::string_view::npos ? 0 : nl+1);
+        *parsed_end = pos + data.size();
+    }
+    if(src_out) *src_out = src;
+    auto bounds = csv_chunk_bounds(data, threads, threads);
+    std::vector<BarChunk> chunks(bounds.size()-1);
+    if(chunks.size()==1){
+        parse_bar_chunk(data, st.cols, src, chunks[0]);
+    }else{
+        std::vector<std::thread> pool;
+        for(size_t k=0;k<chunks.size();++k)
+            pool.emplace_back([&, k]{
+                parse_bar_chunk(data.substr(bounds[k], bounds[k+1]-bounds[k]), st.cols, src, chunks[k]);
+            });
+        for(auto& t: pool) t.join();
+    }
+    BarTable& b = st.bars;
+    bool sorted=true;
+    stitch_bar_chunks(chunks, b, sorted);
+
+    if(!sorted){
+        std::vector<size_t> perm(b.size());
+        for(size_t i=0;i<perm.size();++i) perm[i]=i;
+        std::stable_sort(perm.begin(), perm.end(), [&](size_t x, size_t y){ return b.ts[x]<b.ts[y]; });
+        reorder_bars(b, perm);
+    }
+    return true;
+}
+
+// ───────────────────────────── binary bar cache (<csv>.bcache)
+// Layout (native byte order, every section 8-byte aligned):
+//   BarCacheHeader, then length-prefixed strings (header names, then the string
+//   pool), then the columns ts, open, high, low, close, volume (8 bytes per bar),
+//   rtype, publisher, instrument, symbol (4 bytes per bar), the text cell ends
+//   (8 bytes per cell, nText per bar) and the text bytes (zero-padded to 8).
+// The source CSV's size and mtime are stored; any change triggers a rebuild.
+static constexpr char     BAR_CACHE_MAGIC[8] = {'O','J','B','A','R','S','\0','\0'};
+static constexpr uint32_t BAR_CACHE_VERSION  = 3;
+static constexpr uint32_t BAR_CACHE_BOM      = 0x01020304;
+
+struct BarCacheHeader{
+    char     magic[8];
+    uint32_t version, bom;
+    uint64_t src_size;
+    int64_t  src_mtime;
+    uint64_t rows;
+    int64_t  ts_min, ts_max;
+    int32_t  decimals[4];
+    uint32_t ncols;                   // columns (roles follow as uint8 in the strings block)
+    uint32_t npool;                   // string pool entries
+    uint32_t ntext, pad_;             // text cells per bar
+    uint64_t text_bytes;
+};
+static_assert(sizeof(BarCacheHeader)%8==0, "cache header must keep columns aligned");
+
+static bool source_stamp(const std::string& path, uint64_t& size, int64_t& mtime){
+    std::error_code ec;
+    size = (uint64_t)fs::file_size(path, ec);
+    if(ec) return false;
+    auto t = fs::last_write_time(path, ec);
+    if(ec) return false;
+    mtime = (int64_t)t.time_since_epoch().count();
+    return true;
+}
+
+static bool write_bar_cache(const std::string& cachePath, const OhlcvStore& st, uint64_t src_size, int64_t src_mtime){
+    const BarTable& b = st.bars;
+    BarCacheHeader h{};
+    std::memcpy(h.magic, BAR_CACHE_MAGIC, sizeof h.magic);
+    h.version=BAR_CACHE_VERSION; h.bom=BAR_CACHE_BOM;
+    h.src_size=src_size; h.src_mtime=src_mtime;
+    h.rows=b.size();
+    h.ts_min = b.size() ? b.ts.front() : 0;
+    h.ts_max = b.size() ? b.ts.back()  : 0;
+    for(int j=0;j<4;++j) h.decimals[j]=b.decimals[j];
+    h.ncols=(uint32_t)st.cols.size();
+    h.ntext=b.nText; h.text_bytes=b.text.size();
+    h.npool=(uint32_t)b.pool.strs.size();
+
+    std::string blob;
+    auto put_str=[&](const std::string& s){
+        uint32_t n=(uint32_t)s.size();
+        blob.append((const char*)&n, sizeof n); blob.append(s);
+    };
+    for(size_t k=0;k<st.cols.size();++k){ put_str(st.header[k]); blob.push_back((char)st.cols[k]); }
+    for(const auto& s: b.pool.strs) put_str(s);
+    blob.resize((blob.size()+7)/8*8, '\0');
+    uint64_t blob_size=blob.size();
+
+    const std::string tmp = cachePath + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary|std::ios::trunc);
+        if(!out) return false;
+        out.write((const char*)&h, sizeof h);
+        out.write((const char*)&blob_size, sizeof blob_size);
+        out.write(blob.data(), (std::streamsize)blob.size());
+        auto col=[&](const auto& v){
+            out.write((const char*)v.data(), (std::streamsize)(v.size()*sizeof(v[0])));
+        };
+        col(b.ts); col(b.open); col(b.high); col(b.low); col(b.close); col(b.volume);
+        col(b.rtype); col(b.publisher); col(b.instrument); col(b.symbol);
+        col(b.textEnd);
+        out.write(b.text.data(), (std::streamsize)b.text.size());
+        out.write("\0\0\0\0\0\0\0", (std::streamsize)((8 - b.text.size()%8)%8));
+        if(!out) return false;
+    }
+    std::error_code ec;
+    fs::rename(tmp, cachePath, ec);
+    if(ec){ fs::remove(tmp, ec); return false; }
+    return true;
+}
+
+// Load header/cols/bars from a cache built for exactly this source size/mtime
+static bool read_bar_cache(const std::string& cachePath, uint64_t src_size, int64_t src_mtime, OhlcvStore& st){
+    MappedFile mf;
+    if(!mf.open(cachePath)) return false;
+    const char* p = mf.data();
+    const char* end = p + mf.size();
+    BarCacheHeader h;
+    uint64_t blob_size=0;
+    if(mf.size() < sizeof h + sizeof blob_size) return false;
+    std::memcpy(&h, p, sizeof h); p += sizeof h;
+    if(std::memcmp(h.magic, BAR_CACHE_MAGIC, sizeof h.magic)!=0 || h.version!=BAR_CACHE_VERSION ||
+       h.bom!=BAR_CACHE_BOM || h.src_size!=src_size || h.src_mtime!=src_mtime) return false;
+    std::memcpy(&blob_size, p, sizeof blob_size); p += sizeof blob_size;
+    const uint64_t n = h.rows;
+    if(h.ntext==0 || (uint64_t)(end-p) < blob_size ||
+       (uint64_t)(end-p) - blob_size != n*(6*8 + 4*4 + 8*(uint64_t)h.ntext) + (h.text_bytes+7)/8*8) return false;
+
+    const char* q = p;
+    const char* qend = p + blob_size;
+    auto get_str=[&](std::string& s)->bool{
+        uint32_t len;
+        if(qend-q < (ptrdiff_t)sizeof len) return false;
+        std::memcpy(&len, q, sizeof len); q += sizeof len;
+        if((uint64_t)(qend-q) < len) return false;
+        s.assign(q, len); q += len;
+        return true;
+    };
+    OhlcvStore out;
+    BarTable& b = out.bars;
+    for(uint32_t k=0;k<h.ncols;++k){
+        std::string name;
+        if(!get_str(name) || q>=qend || (uint8_t)*q>(uint8_t)BarCol::Text) return false;
+        out.header.push_back(name); out.cols.push_back((BarCol)(uint8_t)*q++);
+    }
+    if(h.npool==0) return false;
+    b.pool.strs.clear(); b.pool.ids.clear();
+    for(uint32_t k=0;k<h.npool;++k){
+        std::string s;
+        if(!get_str(s)) return false;
+        b.pool.ids.emplace(s, k);
+        b.pool.strs.push_back(std::move(s));
+    }
+    p += blob_size;
+
+    auto col=[&](auto& v){
+        v.resize(n);
+        std::memcpy(v.data(), p, n*sizeof(v[0]));
+        p += n*sizeof(v[0]);
+    };
+    col(b.ts); col(b.open); col(b.high); col(b.low); col(b.close); col(b.volume);
+    col(b.rtype); col(b.publisher); col(b.instrument); col(b.symbol);
+    for(auto* ids: {&b.rtype, &b.publisher, &b.instrument, &b.symbol})
+        for(uint32_t id: *ids) if(id>=h.npool) return false;
+    b.nText = h.ntext;
+    b.textEnd.resize(n*h.ntext);
+    std::memcpy(b.textEnd.data(), p, b.textEnd.size()*sizeof(uint64_t));
+    p += b.textEnd.size()*sizeof(uint64_t);
+    uint64_t prev=0;
+    for(uint64_t e: b.textEnd){ if(e<prev || e>h.text_bytes) return false; prev=e; }
+    b.text.assign(p, (size_t)h.text_bytes);
+
+    for(int j=0;j<4;++j) b.decimals[j]=h.decimals[j];
+    st = std::move(out);
+    return true;
+}
+
+// Cached bars when <csv>.bcache matches the source, otherwise parse and (re)write the cache
+static bool load_ohlcv_store(const std::string& path, OhlcvStore& st, unsigned threads=0, bool use_cache=true){
+    st = OhlcvStore{};
+    const std::string cachePath = path + ".bcache";
+    uint64_t src_size=0; int64_t src_mtime=0;
+    const bool stamped = use_cache && source_stamp(path, src_size, src_mtime);
+    bool cached = stamped && read_bar_cache(cachePath, src_size, src_mtime, st);
+    if(!cached){
+        if(!parse_ohlcv_csv(path, st, threads)) return false;
+        if(stamped && !write_bar_cache(cachePath, st, src_size, src_mtime))
+            std::cerr<<"⚠️ Could not write bar cache "<<cachePath<<"\n";
+    }
+    build_extrema_index(st.bars.high, st.bars.low, st.ext);
+    st.ok=true;
+    std::cout<<"✅ Loaded "<<st.bars.size()<<" OHLCV bars ← "<<(cached ? cachePath : path)<<"\n";
+    return true;
+}
+// Bar i as text cells in header order (the only place bars are formatted), written over the cells of r
+static void bar_row_into(const OhlcvStore& st, size_t i, Row& r){
+    const BarTable& b = st.bars;
+    r.resize(st.cols.size());
+    size_t t=0;                                  // next text cell
+    for(size_t k=0;k<st.cols.size();++k){
+        std::string& cell = r[k];
+        cell.clear();
+        switch(st.cols[k]){
+        case BarCol::Ts: case BarCol::Text: cell.assign(b.text_cell(i, t++)); break;
+        case BarCol::Open:       csv_append_tick(cell, b.open[i],  b.decimals[0]); break;
+        case BarCol::High:       csv_append_tick(cell, b.high[i],  b.decimals[1]); break;
+        case BarCol::Low:        csv_append_tick(cell, b.low[i],   b.decimals[2]); break;
+        case BarCol::Close:      csv_append_tick(cell, b.close[i], b.decimals[3]); break;
+        case BarCol::Volume:     if(b.volume[i]!=VOLUME_NONE) csv_append_int(cell, b.volume[i]); break;
+        case BarCol::Rtype:      cell = b.pool.strs[b.rtype[i]];      break;
+        case BarCol::Publisher:  cell = b.pool.strs[b.publisher[i]];  break;
+        case BarCol::Instrument: cell = b.pool.strs[b.instrument[i]]; break;
+        case BarCol::Symbol:     cell = b.pool.strs[b.symbol[i]];     break;
+        }
+    }
+}
+// Bars with start_et <= ts <= end_et, as a half-open index range [first,last)
+static void ohlcv_window(const OhlcvStore& st, std::time_t start_et, std::time_t end_et,
+                         size_t& first, size_t& last){
+    const auto& ts = st.bars.ts;
+    first = std::lower_bound(ts.begin(), ts.end(), (int64_t)start_et) - ts.begin();
+    last  = std::upper_bound(ts.begin(), ts.end(), (int64_t)end_et)   - ts.begin();
+    if(last<first) last=first;
+}
+
+// ───────────────────────────── instrument partitions
+// A file that mixes instruments is split into one OhlcvStore per instrument,
+// keyed by instrument_id (symbol when there is no instrument column). Each
+// partition has its own time order and extrema index, so a trigger routed to it
+// only ever searches that instrument's bars. A file with one instrument, or no
+// instrument / symbol column, is a single partition that takes every trigger.
+struct OhlcvPartitions{
+    std::deque<OhlcvStore> parts;                      // deque: follow mode adds instruments without moving stores
+    BarCol key=BarCol::Ts;                             // Instrument or Symbol; Ts = not keyed
+    std::unordered_map<std::string,size_t> byKey;      // instrument_id (or symbol) -> part
+    std::unordered_map<std::string,size_t> bySymbol;   // symbol -> part, when keyed by instrument_id
+    OhlcvStore none;                                   // layout only, no bars: triggers of unknown instruments
+    bool ok() const { return !parts.empty(); }
+};
+static const std::vector<uint32_t>& partition_ids(const BarTable& b, BarCol key){
+    return key==BarCol::Instrument ? b.instrument : b.symbol;
+}
+// Route `key` (and, for instrument keys, the instrument's symbol) to partition k
+static void register_partition(OhlcvPartitions& P, size_t k, const std::string& key, const std::string& symbol){
+    if(P.key==BarCol::Ts) return;
+    P.byKey.emplace(key, k);
+    if(P.key==BarCol::Instrument && !symbol.empty()) P.bySymbol.emplace(symbol, k);
+}
+static void register_partition(OhlcvPartitions& P, size_t k, const BarTable& b){
+    if(P.key!=BarCol::Ts) register_partition(P, k, b.pool.strs[partition_ids(b, P.key)[0]], b.pool.strs[b.symbol[0]]);
+}
+// Split a loaded store by instrument. Bars are grouped by their interned key id;
+// each group keeps the file's time order.
+static void partition_ohlcv(OhlcvStore&& all, OhlcvPartitions& P){
+    P = OhlcvPartitions{};
+    P.none.header = all.header; P.none.cols = all.cols;
+    P.none.bars.nText = all.bars.nText;
+    std::copy(std::begin(all.bars.decimals), std::end(all.bars.decimals), std::begin(P.none.bars.decimals));
+    if(!all.ok) return;
+    for(BarCol c: all.cols)
+        if(c==BarCol::Instrument) P.key=BarCol::Instrument;
+        else if(c==BarCol::Symbol && P.key==BarCol::Ts) P.key=BarCol::Symbol;
+
+    const BarTable& b = all.bars;
+    std::vector<std::vector<size_t>> groups;
+    if(P.key!=BarCol::Ts){
+        const auto& ids = partition_ids(b, P.key);
+        std::vector<int> group(b.pool.strs.size(), -1);   // key id -> group
+        for(size_t i=0;i<b.size();++i){
+            int& g = group[ids[i]];
+            if(g<0){ g=(int)groups.size(); groups.emplace_back(); }
+            groups[g].push_back(i);
+        }
+    }
+    if(groups.size()<=1){
+        P.parts.push_back(std::move(all));
+        if(P.parts[0].bars.size()) register_partition(P, 0, P.parts[0].bars);
+        return;
+    }
+    for(const auto& idx: groups){
+        OhlcvStore& st = P.parts.emplace_back();
+        st.header = all.header; st.cols = all.cols;
+        st.bars = gather_bars(b, idx);
+        build_extrema_index(st.bars.high, st.bars.low, st.ext);
+        st.ok = true;
+        register_partition(P, P.parts.size()-1, st.bars);
+    }
+    std::cout<<"✅ "<<P.parts.size()<<" instruments (by "
+             <<(P.key==BarCol::Instrument ? "instrument_id" : "symbol")<<"), indexed separately\n";
+}
+// Latest bar time over all partitions
+static std::time_t latest_bar_time(const OhlcvPartitions& P){
+    int64_t t = std::numeric_limits<int64_t>::min();
+    for(const auto& st: P.parts) if(st.bars.size()) t = std::max(t, st.bars.ts.back());
+    return (std::time_t)t;
+}
+
 // ───────────────────────────── name helpers
 static inline bool ends_with_ci(const std::string& s, const std::string& suf){
     std::string a=tolower_str(s), b=tolower_str(suf);
@@ -263,6 +1054,12 @@ static inline bool ends_with_ci(const std::string& s, const std::string& suf){
 static inline bool is_unresolved_name(const std::string& n){ return ends_with_ci(n,"_unresolved.csv"); }
 static inline bool is_resolved_name(const std::string& n){ return ends_with_ci(n,"_resolved.csv"); }
 static inline bool is_merged_name(const std::string& n){ return tolower_str(n).find("_merged")!=std::string::npos; }
+// Bare trigger file, not one of our derived _Merged/_NextNMin/_Resolved/_Unresolved outputs
+static inline bool is_raw_trigger_name(const std::string& n){
+    std::string l=tolower_str(n);
+    return l.find("_merged")==std::string::npos && l.find("_next")==std::string::npos &&
+           l.find("_resolved")==std::string::npos && l.find("_unresolved")==std::string::npos;
+}
 static inline std::string strip_derivative_suffixes(std::string stem){
     static const std::regex rx(R"((?:_(?:Next\d+Min|Merged|Resolved|Unresolved))+$)");
     return std::regex_replace(stem, rx, "");
@@ -311,7 +1108,7 @@ static void numeric_only(std::vector<std::vector<std::string>>& rows, int c){
         if(looks_like_datetime(r[c])){ r[c]=""; continue; }
         double v=safe_stod(r[c]);
         if(std::isnan(v)) r[c]="";
-        else r[c]=std::to_string(v);
+        else r[c]=format_price(v);
     }
 }
 static void sanitize_pt_values(bool isBuy,const std::vector<std::string>& H,PTIdx idx,
@@ -329,7 +1126,7 @@ static void sanitize_pt_values(bool isBuy,const std::vector<std::string>& H,PTId
             double F = !std::isnan(Q)? Q : (!std::isnan(R)? R : NAN);
             if(!std::isnan(P) && !std::isnan(F)){
                 double pl = isBuy ? (F - P) : (P - F);
-                if(std::fabs(pl) > EPS) r[idx.plCol] = std::to_string(pl);
+                if(std::fabs(pl) > EPS) r[idx.plCol] = format_price(pl);
             }
         }
     }
@@ -344,21 +1141,6 @@ static int find_by_synonyms(const std::vector<std::string>& H, const std::vector
     }
     return -1;
 }
-static void forward_fill_columns(std::vector<std::string>& H,
-                                 std::vector<std::vector<std::string>>& rows,
-                                 const std::vector<std::vector<std::string>>& groups)
-{
-    for(const auto& names : groups){
-        int c = find_by_synonyms(H, names);
-        if(c<0) continue;
-        std::string carry;
-        for(auto& r : rows){
-            if((int)r.size()<=c) r.resize(H.size(),"");
-            if(!r[c].empty()) carry=r[c];
-            else if(!carry.empty()) r[c]=carry;
-        }
-    }
-}
 static void forward_fill_indices(std::vector<std::vector<std::string>>& rows,
                                  const std::vector<int>& cols,
                                  int width)
@@ -374,28 +1156,132 @@ static void forward_fill_indices(std::vector<std::vector<std::string>>& rows,
     }
 }
 
-// ───────────────────────────── sort by time (ts_event ascending)
+// ───────────────────────────── header schemas (column roles per header layout)
+// Column roles are found by normalized name matching, which is costly next to the
+// rows themselves. They are bound once per header layout: header_schema() hashes
+// the header and returns the roles found for it the first time (per thread, so no
+// lock). Thousands of trigger files share a handful of layouts.
 static int find_ts_col(const std::vector<std::string>& H){
     return find_by_synonyms(H, {"ts_event","timestamp","datetime","time","ts","date"});
 }
+static int find_any(const std::vector<std::string>& H, const std::vector<std::string>& syn){
+    int i = findColByNamesExact(H, syn);
+    if(i!=-1) return i;
+    return findColByNames(H, syn);
+}
+
+// Column roles the resolver needs; -1 when absent
+struct LevelCols{ int hi=-1, lo=-1, tp=-1, st_stop=-1, st_limit=-1, sl_stop=-1, sl_limit=-1; };
+static LevelCols find_level_cols(const std::vector<std::string>& H, bool isBuy){
+    LevelCols c;
+    c.hi = find_any(H, {"high"});
+    c.lo = find_any(H, {"low"});
+    c.tp = find_any(H, {"profit order","profitorder","takeprofit","tp","target","profit","profittarget","takeprofitprice"});
+
+    // Entry STOP preferred; STOP-LIMIT fallback
+    c.st_stop = isBuy
+        ? find_any(H, {"buy stop","buy stop $","buystop","entrybuy","buy"})
+        : find_any(H, {"sell stop","sell stop $","sellstop","entrysell","sell"});
+    c.st_limit = isBuy
+        ? find_any(H, {"buy stop limit $","buystoplimit","buystoplimit$"})
+        : find_any(H, {"sell stop limit $","sellstoplimit","sellstoplimit$"});
+
+    // Stop-loss STOP preferred; LIMIT fallback
+    c.sl_stop  = find_any(H, {"stop loss stop $","stoplossstop","stop loss stop","sl stop"});
+    c.sl_limit = find_any(H, {"stop loss limit $","stoplosslimit","stop loss limit","sl limit"});
+    return c;
+}
+static bool level_cols_ok(const LevelCols& c){
+    return !(c.hi==-1||c.lo==-1||c.tp==-1||(c.st_stop==-1 && c.st_limit==-1) || (c.sl_stop==-1 && c.sl_limit==-1));
+}
+
+static const std::vector<std::vector<std::string>> FF_GROUPS = {
+    {"rtype"},
+    {"publisher id","publisher"},
+    {"instrument id","instrument"},
+    {"symbol"},
+    {"buy stop"}, {"buy stop $"}, {"buy stop limit $"},
+    {"sell stop"}, {"sell stop $"}, {"sell stop limit $"},
+    {"profit order"}, {"takeprofit","tp","profittarget","takeprofitprice"},
+    {"stop loss stop $","stoplossstop"},
+    {"stop loss limit $","stoplosslimit"}
+};
+
+struct HeaderSchema{
+    std::vector<std::string> H;                  // the layout (hash collisions are told apart by it)
+    int ts=-1;
+    LevelCols level[2];                          // [isBuy]
+    PTIdx pt[2];                                 // [isBuy], before ensure_pt_cols adds missing ones
+    std::vector<int> ff;                         // column of each FF_GROUPS entry (-1 = absent)
+    int publisher=-1, publisherId=-1, instrument=-1, instrumentId=-1;   // exact labels, for normalize_id_name_inplace
+};
+static HeaderSchema compile_schema(const std::vector<std::string>& H){
+    HeaderSchema s;
+    s.H = H;
+    s.ts = find_ts_col(H);
+    for(int b=0;b<2;++b){
+        s.level[b] = find_level_cols(H, b==1);
+        s.pt[b]    = find_pt_indices(H, b==1);
+    }
+    for(const auto& names: FF_GROUPS) s.ff.push_back(find_by_synonyms(H, names));
+    auto exact=[&](const char* label){
+        for(int i=0;i<(int)H.size();++i) if(H[i]==label) return i;
+        return -1;
+    };
+    s.publisher  = exact("Publisher");  s.publisherId  = exact("Publisher ID");
+    s.instrument = exact("Instrument"); s.instrumentId = exact("Instrument ID");
+    return s;
+}
+static uint64_t header_hash(const std::vector<std::string>& H, uint64_t h = 1469598103934665603ull){   // FNV-1a
+    for(const auto& c: H){
+        for(unsigned char ch: c){ h ^= ch; h *= 1099511628211ull; }
+        h ^= 0xff; h *= 1099511628211ull;
+    }
+    return h;
+}
+static const HeaderSchema& header_schema(const std::vector<std::string>& H){
+    thread_local std::unordered_multimap<uint64_t, HeaderSchema> cache;   // nodes: references stay valid
+    const uint64_t h = header_hash(H);
+    auto range = cache.equal_range(h);
+    for(auto it=range.first; it!=range.second; ++it) if(it->second.H==H) return it->second;
+    return cache.emplace(h, compile_schema(H))->second;
+}
+
+// ───────────────────────────── sort by time (ts_event ascending)
 static std::time_t parse_et_from_cell(const std::string& s, bool& ok){
-    std::tm t{};
-    if(!parse_flex_ts(s,t)){ ok=false; return 0; }
-    ok=true; return et_epoch_from_et_tm(t);
+    TsCell t;
+    if(!parse_ts_cell(s,t)){ ok=false; return 0; }
+    ok=true; return et_epoch_of(t);
 }
+// Rows with a valid time come first in time order, the rest keep their order at the end.
+// Keys are parsed once; input that is already in that order is left untouched.
 static void sort_rows_by_ts(std::vector<std::string>& H,
                             std::vector<std::vector<std::string>>& rows)
 {
-    int tcol = find_ts_col(H);
+    int tcol = header_schema(H).ts;
     if(tcol<0) return; // nothing to sort by
-    std::stable_sort(rows.begin(), rows.end(), [&](const auto& a, const auto& b){
-        bool oka=false, okb=false;
-        std::time_t ta = (tcol<(int)a.size()) ? parse_et_from_cell(a[tcol], oka) : 0;
-        std::time_t tb = (tcol<(int)b.size()) ? parse_et_from_cell(b[tcol], okb) : 0;
-        if(oka && okb) return ta < tb;
-        if(oka != okb) return oka; // rows with valid time first
-        return false; // keep order
+    const size_t n = rows.size();
+    std::vector<std::time_t> key(n, 0);
+    std::vector<char> ok(n, 0);
+    bool sorted = true;
+    for(size_t i=0;i<n;++i){
+        bool v=false;
+        if(tcol<(int)rows[i].size()) key[i]=parse_et_from_cell(rows[i][tcol], v);
+        ok[i]=v;
+        if(i>0 && ((ok[i] && !ok[i-1]) || (ok[i] && ok[i-1] && key[i]<key[i-1]))) sorted=false;
+    }
+    if(sorted) return;
+
+    std::vector<size_t> perm(n);
+    for(size_t i=0;i<n;++i) perm[i]=i;
+    std::stable_sort(perm.begin(), perm.end(), [&](size_t a, size_t b){
+        if(ok[a] && ok[b]) return key[a] < key[b];
+        return ok[a] > ok[b];
     });
+    std::vector<std::vector<std::string>> out;
+    out.reserve(n);
+    for(size_t i: perm) out.push_back(std::move(rows[i]));
+    rows.swap(out);
 }
 
 // ───────────────────────────── resolver (order preserved, STOP > STOP-LIMIT)
@@ -406,105 +1292,137 @@ struct ResolveResult{
     bool   profit_hit=false;
 };
 
-static int find_any(const std::vector<std::string>& H, const std::vector<std::string>& syn){
-    int i = findColByNamesExact(H, syn);
-    if(i!=-1) return i;
-    return findColByNames(H, syn);
-}
-
 static double to_number(const std::string& s){ return safe_stod(s); }
 
-static ResolveResult resolve_rows(bool isBuy,
-                                  std::vector<std::string>& H,
-                                  std::vector<std::vector<std::string>>& rows)
+// Entry stop, profit target and stop-loss: first non-empty value down the rows
+struct TradeLevels{ double stop=NAN, profit=NAN, loss=NAN; };
+static bool find_trade_levels(const LevelCols& c,
+                              const std::vector<std::vector<std::string>>& rows,
+                              TradeLevels& L)
 {
-    int hi = find_any(H, {"high"});
-    int lo = find_any(H, {"low"});
-    int tp = find_any(H, {"profit order","profitorder","takeprofit","tp","target","profit","profittarget","takeprofitprice"});
-
-    // Entry STOP preferred; STOP-LIMIT fallback
-    int st_stop = isBuy
-        ? find_any(H, {"buy stop","buy stop $","buystop","entrybuy","buy"})
-        : find_any(H, {"sell stop","sell stop $","sellstop","entrysell","sell"});
-    int st_limit = isBuy
-        ? find_any(H, {"buy stop limit $","buystoplimit","buystoplimit$"})
-        : find_any(H, {"sell stop limit $","sellstoplimit","sellstoplimit$"});
-
-    // Stop-loss STOP preferred; LIMIT fallback
-    int sl_stop  = find_any(H, {"stop loss stop $","stoplossstop","stop loss stop","sl stop"});
-    int sl_limit = find_any(H, {"stop loss limit $","stoplosslimit","stop loss limit","sl limit"});
-
-    if(hi==-1||lo==-1||tp==-1||(st_stop==-1 && st_limit==-1) || (sl_stop==-1 && sl_limit==-1))
-        return {};
-
-    PTIdx idx = find_pt_indices(H, isBuy);
-    ensure_pt_cols(H, rows, isBuy, idx);
-
-    double stop=NAN, profit=NAN, loss=NAN;
-
+    L = TradeLevels{};
     // Profit target
     for(const auto& r: rows){
-        if(tp>=0 && tp<(int)r.size() && std::isnan(profit)){
-            double v = to_number(r[tp]); if(!std::isnan(v)) profit = v;
+        if(c.tp>=0 && c.tp<(int)r.size() && std::isnan(L.profit)){
+            double v = to_number(r[c.tp]); if(!std::isnan(v)) L.profit = v;
         }
-        if(!std::isnan(profit)) break;
+        if(!std::isnan(L.profit)) break;
     }
     // Entry STOP preferred; then STOP-LIMIT
     for(const auto& r: rows){
-        if(st_stop>=0 && st_stop<(int)r.size() && std::isnan(stop)){
-            double v = to_number(r[st_stop]); if(!std::isnan(v)) stop = v;
+        if(c.st_stop>=0 && c.st_stop<(int)r.size() && std::isnan(L.stop)){
+            double v = to_number(r[c.st_stop]); if(!std::isnan(v)) L.stop = v;
         }
-        if(std::isnan(stop) && st_limit>=0 && st_limit<(int)r.size()){
-            double v = to_number(r[st_limit]); if(!std::isnan(v)) stop = v;
+        if(std::isnan(L.stop) && c.st_limit>=0 && c.st_limit<(int)r.size()){
+            double v = to_number(r[c.st_limit]); if(!std::isnan(v)) L.stop = v;
         }
-        if(!std::isnan(stop)) break;
+        if(!std::isnan(L.stop)) break;
     }
     // Stop-loss STOP preferred; then LIMIT
     for(const auto& r: rows){
-        if(sl_stop>=0 && sl_stop<(int)r.size() && std::isnan(loss)){
-            double v = to_number(r[sl_stop]); if(!std::isnan(v)) loss = v;
+        if(c.sl_stop>=0 && c.sl_stop<(int)r.size() && std::isnan(L.loss)){
+            double v = to_number(r[c.sl_stop]); if(!std::isnan(v)) L.loss = v;
         }
-        if(std::isnan(loss) && sl_limit>=0 && sl_limit<(int)r.size()){
-            double v = to_number(r[sl_limit]); if(!std::isnan(v)) loss = v;
+        if(std::isnan(L.loss) && c.sl_limit>=0 && c.sl_limit<(int)r.size()){
+            double v = to_number(r[c.sl_limit]); if(!std::isnan(v)) L.loss = v;
         }
-        if(!std::isnan(loss)) break;
+        if(!std::isnan(L.loss)) break;
     }
+    return !(std::isnan(L.stop) || std::isnan(L.profit) || std::isnan(L.loss));
+}
 
-    if(std::isnan(stop) || std::isnan(profit) || std::isnan(loss)) return {};
-
-    ResolveResult rr{};
-    for(int i=0;i<(int)rows.size();++i){
-        const auto& r=rows[i];
-        double hi_=safe_stod(r[hi]), lo_=safe_stod(r[lo]);
-        if(isBuy){
-            if(rr.open_idx==-1){
-                if(!std::isnan(hi_) && hi_>=stop){
-                    rr.open_idx=i; rr.open_price=stop+SLIPPAGE;
-                }
-            } else if(rr.fill_idx==-1){
-                if(!std::isnan(hi_) && hi_>=profit){
-                    rr.fill_idx=i; rr.profit_hit=true; rr.fill_price=profit-SLIPPAGE; break;
-                }
-                if(!std::isnan(lo_) && lo_<=loss){
-                    rr.fill_idx=i; rr.profit_hit=false; rr.fill_price=loss-SLIPPAGE; break;
-                }
+// One bar of the entry/exit state machine. Entry fills on the first bar through
+// the stop; exits are only checked on later bars, profit before stop-loss.
+// Returns true once the trade is resolved.
+static inline bool resolve_step(bool isBuy, const TradeLevels& L, double hi_, double lo_,
+                                int i, ResolveResult& rr)
+{
+    if(isBuy){
+        if(rr.open_idx==-1){
+            if(!std::isnan(hi_) && hi_>=L.stop){
+                rr.open_idx=i; rr.open_price=L.stop+SLIPPAGE;
             }
-        }else{
-            if(rr.open_idx==-1){
-                if(!std::isnan(lo_) && lo_<=stop){
-                    rr.open_idx=i; rr.open_price=stop-SLIPPAGE;
-                }
-            } else if(rr.fill_idx==-1){
-                if(!std::isnan(lo_) && lo_<=profit){
-                    rr.fill_idx=i; rr.profit_hit=true; rr.fill_price=profit+SLIPPAGE; break;
-                }
-                if(!std::isnan(hi_) && hi_>=loss){
-                    rr.fill_idx=i; rr.profit_hit=false; rr.fill_price=loss+SLIPPAGE; break;
-                }
+        } else if(rr.fill_idx==-1){
+            if(!std::isnan(hi_) && hi_>=L.profit){
+                rr.fill_idx=i; rr.profit_hit=true; rr.fill_price=L.profit-SLIPPAGE; return true;
+            }
+            if(!std::isnan(lo_) && lo_<=L.loss){
+                rr.fill_idx=i; rr.profit_hit=false; rr.fill_price=L.loss-SLIPPAGE; return true;
+            }
+        }
+    }else{
+        if(rr.open_idx==-1){
+            if(!std::isnan(lo_) && lo_<=L.stop){
+                rr.open_idx=i; rr.open_price=L.stop-SLIPPAGE;
+            }
+        } else if(rr.fill_idx==-1){
+            if(!std::isnan(lo_) && lo_<=L.profit){
+                rr.fill_idx=i; rr.profit_hit=true; rr.fill_price=L.profit+SLIPPAGE; return true;
+            }
+            if(!std::isnan(hi_) && hi_>=L.loss){
+                rr.fill_idx=i; rr.profit_hit=false; rr.fill_price=L.loss+SLIPPAGE; return true;
             }
         }
     }
-
+    return false;
+}
+
+// The same state machine over whole high/low columns with the first-crossing
+// kernels: entry, then the first profit touch and the first stop-loss touch
+// before it (profit wins a same-bar tie). Side is fixed at compile time.
+enum class Side : unsigned char { Buy, Sell };
+template<Side S>
+static void resolve_scan(const TradeLevels& L, const std::vector<double>& hi, const std::vector<double>& lo,
+                         ResolveResult& rr)
+{
+    constexpr bool buy = (S==Side::Buy);
+    const size_t n = hi.size();
+    const double* up = hi.data();      // buy: entry + profit on highs, loss on lows
+    const double* dn = lo.data();
+    size_t e = buy ? first_cmp<Cmp::GE>(up, 0, n, L.stop) : first_cmp<Cmp::LE>(dn, 0, n, L.stop);
+    if(e>=n) return;
+    rr.open_idx=(int)e; rr.open_price = buy ? L.stop+SLIPPAGE : L.stop-SLIPPAGE;
+
+    size_t p = buy ? first_cmp<Cmp::GE>(up, e+1, n, L.profit) : first_cmp<Cmp::LE>(dn, e+1, n, L.profit);
+    size_t lim = p<n ? p+1 : n;
+    size_t l = buy ? first_cmp<Cmp::LE>(dn, e+1, lim, L.loss) : first_cmp<Cmp::GE>(up, e+1, lim, L.loss);
+    if(l<p){
+        rr.fill_idx=(int)l; rr.profit_hit=false; rr.fill_price = buy ? L.loss-SLIPPAGE : L.loss+SLIPPAGE;
+    }else if(p<n){
+        rr.fill_idx=(int)p; rr.profit_hit=true;  rr.fill_price = buy ? L.profit-SLIPPAGE : L.profit+SLIPPAGE;
+    }
+}
+
+static ResolveResult resolve_rows(bool isBuy,
+                                  std::vector<std::string>& H,
+                                  std::vector<std::vector<std::string>>& rows)
+{
+    const LevelCols c = header_schema(H).level[isBuy];
+    if(!level_cols_ok(c)) return {};
+
+    PTIdx idx = header_schema(H).pt[isBuy];
+    ensure_pt_cols(H, rows, isBuy, idx);
+
+    TradeLevels L;
+    if(!find_trade_levels(c, rows, L)) return {};
+
+    // parse high/low once, then a plain numeric scan
+    std::vector<double> hiv(rows.size()), lov(rows.size());
+    for(size_t i=0;i<rows.size();++i){
+        hiv[i]=safe_stod(rows[i][c.hi]);
+        lov[i]=safe_stod(rows[i][c.lo]);
+    }
+    ResolveResult rr{};
+    if(isBuy) resolve_scan<Side::Buy>(L, hiv, lov, rr);
+    else      resolve_scan<Side::Sell>(L, hiv, lov, rr);
+#ifdef OJ_VERIFY_KERNELS
+    ResolveResult ref{};
+    for(int i=0;i<(int)rows.size();++i)
+        if(resolve_step(isBuy, L, hiv[i], lov[i], i, ref)) break;
+    if(ref.open_idx!=rr.open_idx || ref.fill_idx!=rr.fill_idx || ref.profit_hit!=rr.profit_hit)
+        throw std::runtime_error("first-crossing kernel disagrees with resolve_step");
+#endif
+
     if(!std::isnan(rr.open_price) && !std::isnan(rr.fill_price))
         rr.pl = isBuy ? (rr.fill_price - rr.open_price) : (rr.open_price - rr.fill_price);
 
@@ -513,15 +1431,15 @@ static ResolveResult resolve_rows(bool isBuy,
         auto& r=rows[i];
         if(idx.resCol>=0 && r[idx.resCol].empty()) r[idx.resCol]="Not Resolved";
         if(i==rr.open_idx && idx.openCol>=0 && r[idx.openCol].empty())
-            r[idx.openCol]=std::to_string(rr.open_price);
+            r[idx.openCol]=format_price(rr.open_price);
 
         if(i==rr.fill_idx){
             if(rr.profit_hit && idx.qCol>=0 && r[idx.qCol].empty())
-                r[idx.qCol]=std::to_string(rr.fill_price);
+                r[idx.qCol]=format_price(rr.fill_price);
             if(!rr.profit_hit && idx.rCol>=0 && r[idx.rCol].empty())
-                r[idx.rCol]=std::to_string(rr.fill_price);
+                r[idx.rCol]=format_price(rr.fill_price);
             if(idx.plCol>=0 && r[idx.plCol].empty() && !std::isnan(rr.pl) && std::fabs(rr.pl)>EPS)
-                r[idx.plCol]=std::to_string(rr.pl);
+                r[idx.plCol]=format_price(rr.pl);
             if(idx.resCol>=0)
                 r[idx.resCol] = saw_first ? "Resolved (Before)" : "Resolved (First)";
             saw_first=true;
@@ -536,15 +1454,10 @@ static ResolveResult resolve_rows(bool isBuy,
 }
 
 // ───────────────────────────── ID/name normalization (in-place)
-static inline int find_col_exact(const std::vector<std::string>& H, const std::string& label){
-    for (int i=0;i<(int)H.size();++i)
-        if (H[i] == label) return i;
-    return -1;
-}
 static void normalize_id_name_inplace(std::vector<std::string>& H,
                                       std::vector<std::vector<std::string>>& rows){
-    auto move_numeric = [&](const char* nameCol, const char* idCol){
-        int cName=find_col_exact(H, nameCol), cID=find_col_exact(H, idCol);
+    const HeaderSchema& s = header_schema(H);
+    auto move_numeric = [&](int cName, int cID){
         if(cName==-1 || cID==-1) return;
         for(auto& r: rows){
             if((int)r.size()<=std::max(cName,cID)) continue;
@@ -558,8 +1471,8 @@ static void normalize_id_name_inplace(std::vector<std::string>& H,
             }
         }
     };
-    move_numeric("Publisher",  "Publisher ID");
-    move_numeric("Instrument", "Instrument ID");
+    move_numeric(s.publisher,  s.publisherId);
+    move_numeric(s.instrument, s.instrumentId);
 }
 
 // ───────────────────────────── Merge (STRICT, canonicalized, sorted)
@@ -583,43 +1496,72 @@ static bool canonicalize_right_header(const std::string& raw, std::string& keyOu
     return false;
 }
 
-static void mergeCSVs_union(const std::string& fLeft,
-                            const std::string& fOHLCV,
-                            const std::string& outMerged)
+// One input of the union merge: a header plus random access to its data rows.
+// Trigger (left) inputs keep their columns except leaked "OHLCV ..." ones;
+// OHLCV (right) inputs keep only canonicalized price/volume/meta columns.
+struct MergeInput{
+    std::vector<std::string> H;
+    bool ohlcv=false;
+    size_t n=0;
+    std::function<const std::vector<std::string>&(size_t)> row;
+    std::function<std::time_t(size_t)> key;     // optional: ET time of row i, for inputs known to be timed and in order
+};
+static MergeInput table_input(const std::vector<std::string>& H,
+                              const std::vector<std::vector<std::string>>& rows, bool ohlcv)
 {
-    std::ifstream a(fLeft), b(fOHLCV);
-    if(!a||!b) throw std::runtime_error("Missing merge inputs");
+    MergeInput in;
+    in.H=H; in.ohlcv=ohlcv; in.n=rows.size();
+    in.row=[&rows](size_t i)->const std::vector<std::string>&{ return rows[i]; };
+    return in;
+}
+using RowSink = std::function<void(std::vector<std::string>&)>;
 
-    std::string hL, hR;
-    if(!getline_nonempty(a,hL) || !getline_nonempty(b,hR)) return;
-    auto leftH_raw  = splitCSV(hL);
-    auto rightH_raw = splitCSV(hR);
+// Union header and column maps of a merge; depends only on the inputs' headers
+struct MergePlan{
+    std::vector<std::pair<bool, std::vector<std::string>>> layout;   // (ohlcv, header) per input
+    std::vector<std::string> H;
+    std::vector<std::vector<int>> maps;          // [input][union column] -> source column (-1 = none)
+    int tcol=-1;
+    std::vector<int> ffCols;
+};
+static MergePlan build_merge_plan(const std::vector<MergeInput>& ins){
+    MergePlan plan;
+    std::vector<std::string>& H = plan.H;
+    static const std::vector<std::string> TS_NAMES = {"ts_event","timestamp","datetime","time","ts"};
 
-    // LEFT FILTER: drop any "OHLCV ..." column that leaked
+    // LEFT FILTER: drop any "OHLCV ..." column that leaked; later trigger inputs add unseen names
+    std::vector<std::vector<std::string>> filtered(ins.size());
     std::vector<std::string> leftH;
-    leftH.reserve(leftH_raw.size());
-    for(int i=0;i<(int)leftH_raw.size();++i){
-        if(starts_with_ci_after_trim_ohlcv(leftH_raw[i])) continue;
-        leftH.push_back(leftH_raw[i]);
+    bool firstLeft=true;
+    for(size_t k=0;k<ins.size();++k){
+        if(ins[k].ohlcv) continue;
+        for(const auto& h: ins[k].H){
+            if(starts_with_ci_after_trim_ohlcv(h)) continue;
+            filtered[k].push_back(h);
+            if(firstLeft || std::find(leftH.begin(), leftH.end(), h)==leftH.end()) leftH.push_back(h);
+        }
+        firstLeft=false;
     }
 
     // RIGHT FILTER + CANONICALIZATION
     struct RMap { int src; std::string key; std::string label; };
-    std::vector<RMap> rightCols;
-    for(int i=0;i<(int)rightH_raw.size();++i){
-        std::string key,label;
-        if(canonicalize_right_header(rightH_raw[i], key, label)){
-            rightCols.push_back({i,key,label});
+    std::vector<std::vector<RMap>> rightCols(ins.size());
+    bool rightHasTs=false;
+    for(size_t k=0;k<ins.size();++k){
+        if(!ins[k].ohlcv) continue;
+        for(int i=0;i<(int)ins[k].H.size();++i){
+            std::string key,label;
+            if(canonicalize_right_header(ins[k].H[i], key, label)){
+                rightCols[k].push_back({i,key,label});
+                if(key=="tsevent") rightHasTs=true;
+            }
         }
     }
 
     // Build union header: put time first
-    std::vector<std::string> H;
-    int leftTs = find_by_synonyms(leftH, {"ts_event","timestamp","datetime","time","ts"});
+    H.clear();
+    int leftTs = find_by_synonyms(leftH, TS_NAMES);
     if(leftTs==-1){
-        bool rightHasTs=false;
-        for(const auto& rc: rightCols)
-            if(rc.key=="tsevent"){ rightHasTs=true; break; }
         if(rightHasTs) H.push_back("ts_event");
     }else{
         H.push_back(leftH[leftTs]);
@@ -644,23 +1586,9 @@ static void mergeCSVs_union(const std::string& fLeft,
     add_if_missing({"instrument id","instrument"}, "Instrument");
     add_if_missing({"symbol"}, "symbol");
 
-    // Map LEFT columns by exact names present in leftH_raw
-    std::vector<int> mapL(H.size(), -1);
-    for(size_t j=0;j<H.size();++j){
-        std::string target = H[j];
-        int src = find_by_synonyms(leftH, {target});
-        if(src==-1 && norm_alnum(target)=="tsevent")
-            src = find_by_synonyms(leftH, {"ts_event","timestamp","datetime","time","ts"});
-        if(src!=-1){
-            for(size_t k=0;k<leftH_raw.size();++k)
-                if(leftH_raw[k]==leftH[src]){ mapL[j]=(int)k; break; }
-        }
-    }
-
-    // Map RIGHT
-    std::vector<int> mapR(H.size(), -1);
+    // Source column of every union column, per input
     auto dest_for_key = [&](const std::string& key)->int{
-        if(key=="tsevent")     return find_by_synonyms(H, {"ts_event","timestamp","datetime","time","ts"});
+        if(key=="tsevent")     return find_by_synonyms(H, TS_NAMES);
         if(key=="open")        return find_by_synonyms(H, {"open"});
         if(key=="high")        return find_by_synonyms(H, {"high"});
         if(key=="low")         return find_by_synonyms(H, {"low"});
@@ -672,46 +1600,26 @@ static void mergeCSVs_union(const std::string& fLeft,
         if(key=="symbol")      return find_by_synonyms(H, {"symbol"});
         return -1;
     };
-    for(const auto& rc: rightCols){
-        int dj = dest_for_key(rc.key);
-        if(dj!=-1) mapR[dj] = rc.src;
-    }
-
-    std::vector<std::vector<std::string>> rows;
-
-    // left rows
-    {
-        a.clear(); a.seekg(0);
-        std::string dummy;
-        if(!getline_nonempty(a,dummy)) return;
-        std::string line;
-        while(std::getline(a,line)){
-            if(line.empty()) continue;
-            auto c=splitCSV(line);
-            std::vector<std::string> row(H.size(), "");
-            for(size_t j=0;j<H.size();++j){
-                int srcCol = mapL[j];
-                if(srcCol!=-1 && (size_t)srcCol<c.size()) row[j]=c[srcCol];
+    std::vector<std::vector<int>>& maps = plan.maps;
+    maps.assign(ins.size(), std::vector<int>(H.size(), -1));
+    for(size_t k=0;k<ins.size();++k){
+        std::vector<int>& map = maps[k];
+        if(ins[k].ohlcv){
+            for(const auto& rc: rightCols[k]){
+                int dj = dest_for_key(rc.key);
+                if(dj!=-1) map[dj] = rc.src;
             }
-            rows.push_back(std::move(row));
+            continue;
         }
-    }
-
-    // right rows
-    {
-        b.clear(); b.seekg(0);
-        std::string dummy;
-        if(!getline_nonempty(b,dummy)) return;
-        std::string line;
-        while(std::getline(b,line)){
-            if(line.empty()) continue;
-            auto c=splitCSV(line);
-            std::vector<std::string> row(H.size(), "");
-            for(size_t j=0;j<H.size();++j){
-                int srcCol = mapR[j];
-                if(srcCol!=-1 && (size_t)srcCol<c.size()) row[j]=c[srcCol];
+        // LEFT: by exact names present in the raw header
+        const auto& fH = filtered[k];
+        for(size_t j=0;j<H.size();++j){
+            int src = find_by_synonyms(fH, {H[j]});
+            if(src==-1 && norm_alnum(H[j])=="tsevent") src = find_by_synonyms(fH, TS_NAMES);
+            if(src!=-1){
+                for(size_t c=0;c<ins[k].H.size();++c)
+                    if(ins[k].H[c]==fH[src]){ map[j]=(int)c; break; }
             }
-            rows.push_back(std::move(row));
         }
     }
 
@@ -721,154 +1629,665 @@ static void mergeCSVs_union(const std::string& fLeft,
         if(h0n=="timestamp"||h0n=="datetime"||h0n=="time"||h0n=="ts") H[0]="ts_event";
     }
 
-    // Sort ascending by ts_event BEFORE forward-filling
-    sort_rows_by_ts(H, rows);
+    plan.tcol = header_schema(H).ts;
+    for(int col: header_schema(H).ff) if(col>=0) plan.ffCols.push_back(col);
+    for(const auto& in: ins) plan.layout.emplace_back(in.ohlcv, in.H);
+    return plan;
+}
+// Plans are cached per thread by the inputs' header layouts, like header_schema()
+static const MergePlan& merge_plan(const std::vector<MergeInput>& ins){
+    thread_local std::unordered_multimap<uint64_t, MergePlan> cache;
+    uint64_t h = 1469598103934665603ull;
+    for(const auto& in: ins) h = header_hash(in.H, h ^ (in.ohlcv ? 0x9e3779b97f4a7c15ull : 0));
+    auto same = [&](const MergePlan& p){
+        if(p.layout.size()!=ins.size()) return false;
+        for(size_t k=0;k<ins.size();++k)
+            if(p.layout[k].first!=ins[k].ohlcv || p.layout[k].second!=ins[k].H) return false;
+        return true;
+    };
+    auto range = cache.equal_range(h);
+    for(auto it=range.first; it!=range.second; ++it) if(same(it->second)) return it->second;
+    return cache.emplace(h, build_merge_plan(ins))->second;
+}
 
-    // Forward-fill meta + trade parameter columns across sorted rows
-    forward_fill_columns(H, rows, {
-        {"rtype"},
-        {"publisher id","publisher"},
-        {"instrument id","instrument"},
-        {"symbol"},
-        // trade params (both sides)
-        {"buy stop"}, {"buy stop $"}, {"buy stop limit $"},
-        {"sell stop"}, {"sell stop $"}, {"sell stop limit $"},
-        {"profit order"}, {"takeprofit","tp","profittarget","takeprofitprice"},
-        {"stop loss stop $","stoplossstop"},
-        {"stop loss limit $","stoplosslimit"}
-    });
+// Union merge of any number of inputs under one canonical header. Inputs are
+// merged k-way by time through a heap of cursors (ties and unparseable rows keep
+// input order, left inputs first) and forward-filled as rows are emitted, so
+// nothing is concatenated or re-sorted. An input already in time order is read
+// in place with only its current key held; one that is not is ordered by a key
+// permutation first. Each merged row is handed to `sink` (which may move from
+// it), so the merge itself holds O(inputs) state for ordered inputs; whether the
+// rows are kept is up to the sink.
+static void merge_union_stream(const std::vector<MergeInput>& ins,
+                               std::vector<std::string>& H,
+                               const RowSink& sink)
+{
+    const MergePlan& plan = merge_plan(ins);
+    H = plan.H;
+    const auto& maps = plan.maps;
+    const int tcol = plan.tcol;
+    const auto& ffCols = plan.ffCols;
+
+    // Per input: a cursor over its rows in merge order (timed rows by time, then the rest)
+    struct Cursor{
+        size_t at=0, n=0;
+        std::vector<size_t> order;               // only for inputs not already in that order
+        std::vector<std::time_t> keys;           // keys of `order` (same indices)
+        std::vector<char> oks;
+        std::time_t key=0; bool ok=false;        // the row under the cursor
+    };
+    auto parse_key=[&](size_t k, size_t i, bool& ok)->std::time_t{
+        ok=false;
+        const int sc = tcol<0 ? -1 : maps[k][tcol];
+        if(sc==-1) return 0;
+        if(ins[k].key){ ok=true; return ins[k].key(i); }
+        const auto& r = ins[k].row(i);
+        return (size_t)sc<r.size() ? parse_et_from_cell(r[sc], ok) : 0;
+    };
+    std::vector<Cursor> cur(ins.size());
+    for(size_t k=0;k<ins.size();++k){
+        Cursor& c = cur[k];
+        c.n = ins[k].n;
+        if(ins[k].key) continue;                 // timed and ordered by construction
+        bool sorted=true, prevOk=false;
+        std::time_t prev=0;
+        for(size_t i=0;i<c.n && sorted;++i){
+            bool v; std::time_t t = parse_key(k, i, v);
+            if(i>0 && v && (!prevOk || t<prev)) sorted=false;
+            prev=t; prevOk=v;
+        }
+        if(sorted) continue;
+        std::vector<std::time_t> key(c.n);
+        std::vector<char> ok(c.n);
+        for(size_t i=0;i<c.n;++i){ bool v; key[i]=parse_key(k, i, v); ok[i]=v; }
+        c.order.resize(c.n);
+        for(size_t i=0;i<c.n;++i) c.order[i]=i;
+        std::stable_sort(c.order.begin(), c.order.end(), [&](size_t a, size_t b){
+            if(ok[a] && ok[b]) return key[a] < key[b];
+            return ok[a] > ok[b];
+        });
+        c.keys.resize(c.n); c.oks.resize(c.n);
+        for(size_t i=0;i<c.n;++i){ c.keys[i]=key[c.order[i]]; c.oks[i]=ok[c.order[i]]; }
+    }
+    auto src_of=[&](const Cursor& c){ return c.order.empty() ? c.at : c.order[c.at]; };
+    auto load=[&](size_t k){                     // key of the row under cursor k
+        Cursor& c = cur[k];
+        if(c.at>=c.n){ c.ok=false; return; }
+        if(!c.order.empty()){ c.key=c.keys[c.at]; c.ok=c.oks[c.at]; }
+        else c.key = parse_key(k, c.at, c.ok);
+    };
 
-    writeCSV_raw(outMerged, H, rows);
-    std::cout<<"✅ Strict, sorted merge completed → "<<outMerged<<"\n";
+    // Forward-fill meta + trade parameter columns inline
+    std::vector<std::string> carry(ffCols.size());
+
+    std::vector<std::string> row;
+    RowPool& pool = row_pool();
+    auto emit=[&](size_t k){
+        Cursor& c = cur[k];
+        const auto& src = ins[k].row(src_of(c));
+        ++c.at;
+        const auto& map = maps[k];
+        if(row.empty()) row = pool.take();       // the sink usually moved the last one out
+        row.resize(H.size());
+        for(size_t j=0;j<H.size();++j){
+            int sc = map[j];
+            if(sc!=-1 && (size_t)sc<src.size()) row[j]=src[sc];
+            else row[j].clear();
+        }
+        for(size_t g=0;g<ffCols.size();++g){
+            std::string& cell = row[ffCols[g]];
+            if(!cell.empty()) carry[g]=cell;
+            else if(!carry[g].empty()) cell=carry[g];
+        }
+        sink(row);
+    };
+    // timed rows: smallest key next, lowest input index on ties
+    using Head = std::pair<std::time_t, size_t>;
+    std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heap;
+    for(size_t k=0;k<cur.size();++k){
+        load(k);
+        if(cur[k].ok) heap.push({cur[k].key, k});
+    }
+    while(!heap.empty()){
+        const size_t k = heap.top().second;
+        heap.pop();
+        emit(k);
+        load(k);
+        if(cur[k].ok) heap.push({cur[k].key, k});
+    }
+    // then rows without a usable time, input by input
+    for(size_t k=0;k<cur.size();++k)
+        while(cur[k].at<cur[k].n) emit(k);
 }
 
-// ───────────────────────────── writer wrapper
-static void writeCSV(const std::string& filename,
-                     std::vector<std::string> H,
-                     std::vector<std::vector<std::string>> rows)
+// In-memory union merge of one trigger table (left) and one OHLCV table (right)
+static void merge_union_rows(const std::vector<std::string>& leftH_raw,
+                             const std::vector<std::vector<std::string>>& leftRows,
+                             const std::vector<std::string>& rightH_raw,
+                             const std::vector<std::vector<std::string>>& rightRows,
+                             std::vector<std::string>& H,
+                             std::vector<std::vector<std::string>>& rows)
 {
-    for(auto& r: rows) r.resize(H.size());
-    writeCSV_raw(filename, H, rows);
+    rows.clear();
+    rows.reserve(leftRows.size()+rightRows.size());
+    merge_union_stream({table_input(leftH_raw, leftRows, false), table_input(rightH_raw, rightRows, true)}, H,
+                       [&](std::vector<std::string>& r){ rows.push_back(std::move(r)); });
 }
 
-// ───────────────────────────── resolve-only pipeline (Attempt 1)
-static void resolve_only_pipeline(const std::string& leftUnresolved,
-                                  const std::string& outDir)
+// Header + non-empty data rows of a CSV (header = first non-blank line)
+static bool read_csv_rows(const std::string& path,
+                          std::vector<std::string>& H,
+                          std::vector<std::vector<std::string>>& rows)
 {
-    std::ifstream in(leftUnresolved);
-    if(!in.is_open()) return;
-    std::string head;
-    if(!getline_nonempty(in, head)){ in.close(); return; }
-    auto H=splitCSV(head);
+    MappedFile mf;
+    if(!mf.open(path)) return false;
+    size_t pos=0;
+    std::string_view line;
+    if(!csv_next_nonempty_line(mf.view(), pos, line)) return false;
+    H=splitCSV(line);
+    row_pool().give(rows);
+    while(csv_next_line(mf.view(), pos, line)) if(!line.empty()) rows.push_back(split_pooled(line));
+    return true;
+}
 
-    std::vector<std::vector<std::string>> rows;
-    std::string line;
-    while(std::getline(in,line)) if(!line.empty()) rows.push_back(splitCSV(line));
-    in.close();
+// ───────────────────────────── writer wrapper
+// Rows padded / cut to the header's width as they are written (no copy of the table)
+static void writeCSV(const std::string& filename,
+                     const std::vector<std::string>& H,
+                     const std::vector<std::vector<std::string>>& rows)
+{
+    write_table(filename, H, rows, true);
+}
 
-    // Normalize + sort by time (if present)
+// ───────────────────────────── shared pipeline stages
+// Normalize + sort by time (if present) + forward-fill meta/trade params
+static void prepare_rows(std::vector<std::string>& H,
+                         std::vector<std::vector<std::string>>& rows)
+{
     normalize_id_name_inplace(H, rows);
     sort_rows_by_ts(H, rows);
-
-    // Forward-fill meta + trade params inside the trigger rows
-    forward_fill_columns(H, rows, {
-        {"rtype"},
-        {"publisher id","publisher"},
-        {"instrument id","instrument"},
-        {"symbol"},
-        {"buy stop"}, {"buy stop $"}, {"buy stop limit $"},
-        {"sell stop"}, {"sell stop $"}, {"sell stop limit $"},
-        {"profit order"}, {"takeprofit","tp","profittarget","takeprofitprice"},
-        {"stop loss stop $","stoplossstop"},
-        {"stop loss limit $","stoplosslimit"}
-    });
-
-    bool isBuy = tolower_str(leftUnresolved).find("buy")!=std::string::npos;
-    bool isSell= tolower_str(leftUnresolved).find("sell")!=std::string::npos;
-    if(!isBuy && !isSell){
-        std::cerr<<"⚠️ Cannot infer side for "<<leftUnresolved<<"\n";
-        return;
-    }
-
-    PTIdx idx = find_pt_indices(H, isBuy);
+    forward_fill_indices(rows, header_schema(H).ff, (int)H.size());
+}
+// Add PT columns, resolve, drag-fill PT columns (Open / ProfitFilled / StopFilled / P&L)
+static ResolveResult resolve_and_fill(bool isBuy,
+                                      std::vector<std::string>& H,
+                                      std::vector<std::vector<std::string>>& rows)
+{
+    PTIdx idx = header_schema(H).pt[isBuy];
     ensure_pt_cols(H, rows, isBuy, idx);
 
     auto rr = resolve_rows(isBuy, H, rows);
 
-    // Drag-fill PT columns after resolution (Open / ProfitFilled / StopFilled / P&L)
-    PTIdx idx2 = find_pt_indices(H, isBuy);
+    const PTIdx idx2 = header_schema(H).pt[isBuy];
     forward_fill_indices(rows, {idx2.openCol, idx2.qCol, idx2.rCol, idx2.plCol}, (int)H.size());
-
-    std::string out = (fs::path(outDir)/(strip_derivative_suffixes(fs::path(leftUnresolved).stem().string()) +
-                                          (rr.filled? "_Resolved.csv":"_Unresolved.csv"))).string();
     normalize_id_name_inplace(H, rows);
-    writeCSV(out, H, rows);
+    return rr;
+}
+static bool infer_side(const std::string& name, bool& isBuy){
+    isBuy = tolower_str(name).find("buy")!=std::string::npos;
+    bool isSell = tolower_str(name).find("sell")!=std::string::npos;
+    if(!isBuy && !isSell){
+        log_line(std::cerr, "⚠️ Cannot infer side for "+name+"\n");
+        return false;
+    }
+    return true;
 }
 
-// ───────────────────────────── merge+resolve pipeline (Attempts 2+)
-static void union_merge_and_resolve(const std::string& leftUnresolved,
-                                    const std::string& winPath,
-                                    const std::string& outDir)
+// ───────────────────────────── in-memory table passed between pipeline stages
+struct CsvTable{
+    std::vector<std::string> H;
+    std::vector<std::vector<std::string>> rows;
+};
+// OHLCV bars [first,last) of the store as a merge input (rows formatted on demand)
+static MergeInput window_input(const OhlcvStore& store, size_t first, size_t last){
+    MergeInput in;
+    in.H=store.header; in.ohlcv=true; in.n=last>first ? last-first : 0;
+    in.key=[&store, first](size_t i){ return (std::time_t)store.bars.ts[first+i]; };
+    auto scratch = std::make_shared<std::vector<std::string>>();
+    in.row=[&store, first, scratch](size_t i)->const std::vector<std::string>&{
+        bar_row_into(store, first+i, *scratch);
+        return *scratch;
+    };
+    return in;
+}
+static void write_window_csv(const std::string& winPath, const OhlcvStore& store, size_t first, size_t last){
+    thread_local CsvWriter out;
+    if(!out.open(winPath)){
+        log_line(std::cerr, "❌ Cannot write "+winPath+"\n");
+        return;
+    }
+    out.row(store.header);
+    Row r;
+    for(size_t i=first;i<last;++i){
+        bar_row_into(store, i, r);
+        out.row(r);
+    }
+    if(!out.close()) log_line(std::cerr, "❌ Write failed: "+winPath+"\n");
+}
+// The partition a trigger's bars come from: the first instrument_id (else symbol)
+// cell of its own rows. When the file holds several instruments, a trigger that
+// names none, or one without bars, gets the empty store and stays unresolved.
+static const OhlcvStore& route_trigger(const OhlcvPartitions& P, const std::vector<std::string>& H,
+                                       const std::vector<std::vector<std::string>>& rows, const std::string& name)
 {
-    std::string baseStem = strip_derivative_suffixes(fs::path(leftUnresolved).stem().string());
-    std::string merged   = (fs::path(outDir)/(baseStem+"_Merged.csv")).string();
-
-    mergeCSVs_union(leftUnresolved, winPath, merged);
+    if(P.parts.size()<=1) return P.parts.empty() ? P.none : P.parts.front();
+    auto first_cell=[&](int c){
+        if(c>=0) for(const auto& r: rows){
+            std::string v = c<(int)r.size() ? trim(r[c]) : std::string();
+            if(!v.empty()) return v;
+        }
+        return std::string();
+    };
+    const std::string inst = first_cell(find_by_synonyms(H, {"instrument_id","instrument"}));
+    const std::string sym  = first_cell(find_by_synonyms(H, {"symbol"}));
+    if(P.key==BarCol::Instrument && !inst.empty()){
+        auto it = P.byKey.find(inst);
+        if(it!=P.byKey.end()) return P.parts[it->second];
+    }
+    if(!sym.empty()){
+        const auto& bySym = P.key==BarCol::Symbol ? P.byKey : P.bySymbol;
+        auto it = bySym.find(sym);
+        if(it!=bySym.end()) return P.parts[it->second];
+    }
+    if(inst.empty() && sym.empty()) log_line(std::cerr, "⚠️ "+name+": no instrument_id / symbol to pick its OHLCV bars\n");
+    else log_line(std::cerr, "⚠️ "+name+": no OHLCV bars for instrument "+(inst.empty() ? sym : inst)+"\n");
+    return P.none;
+}
 
-    // load merged
-    std::ifstream in(merged);
-    if(!in.is_open()) return;
-    std::string head;
-    if(!getline_nonempty(in, head)){ in.close(); return; }
-    auto H=splitCSV(head);
+// ───────────────────────────── trades table (one row per trigger)
+// Every mode keeps the final state of each trigger it resolved and writes it once,
+// as <out>/Trades.csv and as the columnar Trades.bin, so downstream tools read one
+// file instead of walking the per-trigger outputs.
+static constexpr int64_t TS_NONE = std::numeric_limits<int64_t>::min();
+enum class TradeOutcome : uint8_t { NoEntry, Open, Profit, Loss };
+static const char* outcome_name(TradeOutcome o){
+    switch(o){
+    case TradeOutcome::Open:   return "Open";
+    case TradeOutcome::Profit: return "Profit";
+    case TradeOutcome::Loss:   return "Stop Loss";
+    default:                   return "No Entry";
+    }
+}
+struct TradeRecord{
+    std::string trigger;                         // trigger name (file stem)
+    std::string symbol;                          // first symbol (else instrument_id) cell of its rows
+    bool isBuy=false;
+    TradeOutcome outcome=TradeOutcome::NoEntry;
+    int64_t entryTs=TS_NONE, exitTs=TS_NONE;     // Eastern wall-clock seconds since 1970
+    double entryPrice=NAN, exitPrice=NAN, pl=NAN;
+    int64_t bars=-1;                             // OHLCV bars after the entry bar up to the one that resolved it
+};
+static int64_t et_wall_of_cell(const std::string& s){
+    TsCell c;
+    if(!parse_ts_cell(s, c)) return TS_NONE;
+    return c.utc ? (int64_t)utc_to_et((std::time_t)c.wall) : c.wall;
+}
+// The trade of a resolved table: rows and rr as resolve_and_fill left them. The
+// bar count is taken from the instrument's bars (`store`), not from table rows,
+// whose spacing depends on the mode (trigger rows, gaps between attempt windows).
+// Only when the bars do not reach the exit yet (a live file that has not caught
+// up with the trigger's own rows) are the table rows counted instead.
+static TradeRecord trade_record(const std::string& trigger, bool isBuy, const std::vector<std::string>& H,
+                                const std::vector<std::vector<std::string>>& rows, const ResolveResult& rr,
+                                const OhlcvStore* store)
+{
+    TradeRecord t;
+    t.trigger = trigger;
+    t.isBuy = isBuy;
+    for(int c: {find_by_synonyms(H, {"symbol"}), find_by_synonyms(H, {"instrument_id","instrument"})}){
+        if(c>=0) for(const auto& r: rows)
+            if(c<(int)r.size() && !trim(r[c]).empty()){ t.symbol = trim(r[c]); break; }
+        if(!t.symbol.empty()) break;
+    }
+    const int ts = header_schema(H).ts;
+    auto time_of=[&](int i){ return ts>=0 && i<(int)rows.size() && ts<(int)rows[i].size() ? et_wall_of_cell(rows[i][ts]) : TS_NONE; };
+    if(rr.open_idx>=0){
+        t.outcome = TradeOutcome::Open;
+        t.entryTs = time_of(rr.open_idx);
+        t.entryPrice = rr.open_price;
+    }
+    if(rr.fill_idx>=0){
+        t.outcome = rr.profit_hit ? TradeOutcome::Profit : TradeOutcome::Loss;
+        t.exitTs = time_of(rr.fill_idx);
+        t.exitPrice = rr.fill_price;
+        t.pl = rr.pl;
+        if(rr.open_idx>=0){
+            t.bars = rr.fill_idx - rr.open_idx;
+            bool okIn=false, okOut=false;
+            std::time_t in=0, out=0;
+            if(ts>=0 && ts<(int)rows[rr.open_idx].size() && ts<(int)rows[rr.fill_idx].size()){
+                in  = parse_et_from_cell(rows[rr.open_idx][ts], okIn);
+                out = parse_et_from_cell(rows[rr.fill_idx][ts], okOut);
+            }
+            if(okIn && okOut && store && store->bars.size() && store->bars.ts.back()>=(int64_t)out){
+                const auto& bt = store->bars.ts;
+                t.bars = (std::upper_bound(bt.begin(), bt.end(), (int64_t)out) - bt.begin()) -
+                         (std::upper_bound(bt.begin(), bt.end(), (int64_t)in)  - bt.begin());
+            }
+        }
+    }
+    return t;
+}
+// Records of a run, by trigger name; a later record of the same trigger replaces the earlier one
+struct TradeBook{
+    std::mutex m;
+    std::map<std::string, TradeRecord> byTrigger;
+    void put(TradeRecord t){
+        std::lock_guard<std::mutex> lk(m);
+        std::string key = t.trigger;
+        byTrigger[key] = std::move(t);
+    }
+};
 
-    std::vector<std::vector<std::string>> rows;
-    std::string line;
-    while(std::getline(in,line)) if(!line.empty()) rows.push_back(splitCSV(line));
-    in.close();
+// Trades.bin layout (native byte order, every section 8-byte aligned):
+//   TradesFileHeader, then the trigger and symbol names (uint32 length + bytes,
+//   row by row, zero-padded to 8), then the columns entry_ts, exit_ts, bars
+//   (int64; TS_NONE / -1 = none), entry_price, exit_price, pl (double; NaN = none),
+//   side (uint8, 1 = buy) and outcome (uint8, TradeOutcome).
+static constexpr char     TRADES_FILE_MAGIC[8] = {'O','J','T','R','A','D','E','S'};
+static constexpr uint32_t TRADES_FILE_VERSION  = 1;
+struct TradesFileHeader{
+    char     magic[8];
+    uint32_t version, bom;                       // bom = BAR_CACHE_BOM
+    uint64_t rows;
+    uint64_t names;                              // bytes of the names block, padding included
+};
+static_assert(sizeof(TradesFileHeader)%8==0, "trades header must keep columns aligned");
+
+static bool write_trades_bin(const std::string& path, const std::vector<const TradeRecord*>& T){
+    TradesFileHeader h{};
+    std::memcpy(h.magic, TRADES_FILE_MAGIC, sizeof h.magic);
+    h.version=TRADES_FILE_VERSION; h.bom=BAR_CACHE_BOM;
+    h.rows=T.size();
+
+    std::string blob;
+    auto put_str=[&](const std::string& s){
+        uint32_t n=(uint32_t)s.size();
+        blob.append((const char*)&n, sizeof n); blob.append(s);
+    };
+    for(const auto* t: T){ put_str(t->trigger); put_str(t->symbol); }
+    blob.resize((blob.size()+7)/8*8, '\0');
+    h.names=blob.size();
 
-    // normalize + ensure chronological order
-    normalize_id_name_inplace(H, rows);
-    sort_rows_by_ts(H, rows);
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary|std::ios::trunc);
+        if(!out) return false;
+        out.write((const char*)&h, sizeof h);
+        out.write(blob.data(), (std::streamsize)blob.size());
+        auto col=[&](auto field){
+            using V = decltype(field(*T.front()));
+            std::vector<V> v;
+            v.reserve(T.size());
+            for(const auto* t: T) v.push_back(field(*t));
+            out.write((const char*)v.data(), (std::streamsize)(v.size()*sizeof(V)));
+        };
+        if(!T.empty()){
+            col([](const TradeRecord& t){ return t.entryTs; });
+            col([](const TradeRecord& t){ return t.exitTs; });
+            col([](const TradeRecord& t){ return t.bars; });
+            col([](const TradeRecord& t){ return t.entryPrice; });
+            col([](const TradeRecord& t){ return t.exitPrice; });
+            col([](const TradeRecord& t){ return t.pl; });
+            col([](const TradeRecord& t){ return (uint8_t)t.isBuy; });
+            col([](const TradeRecord& t){ return (uint8_t)t.outcome; });
+        }
+        if(!out) return false;
+    }
+    std::error_code ec;
+    fs::rename(tmp, path, ec);
+    if(ec){ fs::remove(tmp, ec); return false; }
+    return true;
+}
+// <dir>/Trades.csv and <dir>/Trades.bin, trigger name order
+static void write_trades(const TradeBook& book, const std::string& dir){
+    std::vector<const TradeRecord*> T;
+    T.reserve(book.byTrigger.size());
+    for(const auto& kv: book.byTrigger) T.push_back(&kv.second);
+
+    const std::string csvPath = (fs::path(dir)/"Trades.csv").string();
+    CsvWriter out;
+    if(!out.open(csvPath)){
+        std::cerr<<"❌ Cannot write "<<csvPath<<"\n";
+        return;
+    }
+    out.row({"trigger","symbol","side","entry_time","entry_price","exit_time","exit_price","outcome","pl","bars_to_resolution"});
+    auto time_field=[&](int64_t ts){ out.field(ts==TS_NONE ? std::string() : format_wall(ts, TsLayout{})); };
+    for(const auto* t: T){
+        out.field(t->trigger);
+        out.field(t->symbol);
+        out.field(t->isBuy ? "Buy" : "Sell");
+        time_field(t->entryTs);
+        out.number(t->entryPrice, PRICE_DECIMALS);
+        time_field(t->exitTs);
+        out.number(t->exitPrice, PRICE_DECIMALS);
+        out.field(outcome_name(t->outcome));
+        out.number(t->pl, PRICE_DECIMALS);
+        if(t->bars>=0) out.integer(t->bars); else out.field("");
+        out.end_row();
+    }
+    if(!out.close()){
+        std::cerr<<"❌ Write failed: "<<csvPath<<"\n";
+        return;
+    }
+    const std::string binPath = (fs::path(dir)/"Trades.bin").string();
+    if(!write_trades_bin(binPath, T)) std::cerr<<"❌ Cannot write "<<binPath<<"\n";
+    std::cout<<"✅ "<<T.size()<<" trade(s) → "<<csvPath<<" (+ Trades.bin)\n";
+}
 
-    // forward-fill again post-merge (sorted rows)
-    forward_fill_columns(H, rows, {
-        {"rtype"},
-        {"publisher id","publisher"},
-        {"instrument id","instrument"},
-        {"symbol"},
-        {"buy stop"}, {"buy stop $"}, {"buy stop limit $"},
-        {"sell stop"}, {"sell stop $"}, {"sell stop limit $"},
-        {"profit order"}, {"takeprofit","tp","profittarget","takeprofitprice"},
-        {"stop loss stop $","stoplossstop"},
-        {"stop loss limit $","stoplosslimit"}
+// ───────────────────────────── trade metrics (equity, drawdown, ratios)
+// Computed from the trade records of a run and written next to the trades table:
+// Metrics.csv (one row per group: all trades, each side, each day, each symbol)
+// and Equity.csv (the equity curve and drawdown, trade by trade). Closed trades
+// are taken in exit-time order. Each group is one pass of running sums (Welford
+// for the mean / variance); symbols are grouped in parallel.
+struct MetricsAcc{
+    size_t trades=0, entered=0, profit=0, loss=0, open=0;
+    double total=0, grossWin=0, grossLoss=0, best=NAN, worst=NAN;
+    size_t wins=0, losses=0;                     // by the sign of P/L
+    double mean=0, m2=0, downSq=0;               // per-trade P/L moments
+    double equity=0, peak=0, maxDD=0;
+    void push(const TradeRecord& t){
+        ++trades;
+        if(t.outcome==TradeOutcome::NoEntry) return;
+        ++entered;
+        if(t.outcome==TradeOutcome::Open){ ++open; return; }
+        (t.outcome==TradeOutcome::Profit ? profit : loss)++;
+        const double pl = std::isnan(t.pl) ? 0.0 : t.pl;
+        const size_t n = profit + loss;
+        const double d = pl - mean;
+        mean += d/n;
+        m2 += d*(pl - mean);
+        if(pl<0) downSq += pl*pl;
+        if(pl>EPS){ ++wins; grossWin += pl; }
+        else if(pl<-EPS){ ++losses; grossLoss -= pl; }
+        best  = std::isnan(best)  ? pl : std::max(best, pl);
+        worst = std::isnan(worst) ? pl : std::min(worst, pl);
+        total += pl;
+        equity += pl;
+        peak = std::max(peak, equity);
+        maxDD = std::max(maxDD, peak - equity);
+    }
+    size_t closed() const { return profit + loss; }
+    double sharpe() const {                      // per trade: mean / sample standard deviation
+        const size_t n = closed();
+        if(n<2 || m2<=0) return NAN;
+        return mean / std::sqrt(m2/(n-1));
+    }
+    double sortino() const {                     // per trade: mean / downside deviation
+        const size_t n = closed();
+        if(n==0 || downSq<=0) return NAN;
+        return mean / std::sqrt(downSq/n);
+    }
+};
+static std::string day_of(int64_t ts){ return ts==TS_NONE ? std::string() : format_wall(ts, TsLayout{}).substr(0, 10); }
+
+static void write_metrics(const TradeBook& book, const std::string& dir, unsigned threads){
+    // closed trades in exit order, then the rest; ties keep trigger-name order
+    std::vector<const TradeRecord*> T;
+    T.reserve(book.byTrigger.size());
+    for(const auto& kv: book.byTrigger) T.push_back(&kv.second);
+    auto exit_key=[](const TradeRecord* t){ return t->exitTs==TS_NONE ? std::numeric_limits<int64_t>::max() : t->exitTs; };
+    std::stable_sort(T.begin(), T.end(), [&](const TradeRecord* a, const TradeRecord* b){ return exit_key(a)<exit_key(b); });
+
+    // one pass: all trades, side, day (exit date; entry date for trades still open)
+    struct Group{ std::string kind, key; MetricsAcc acc; };
+    std::vector<Group> groups = {{"all", "", {}}, {"side", "Buy", {}}, {"side", "Sell", {}}};
+    std::map<std::string, MetricsAcc> days;
+    std::map<std::string, std::vector<const TradeRecord*>> bySymbol;
+
+    const std::string equityPath = (fs::path(dir)/"Equity.csv").string();
+    CsvWriter eq;
+    if(!eq.open(equityPath)){
+        std::cerr<<"❌ Cannot write "<<equityPath<<"\n";
+        return;
+    }
+    eq.row({"exit_time","trigger","symbol","side","pl","equity","drawdown"});
+    for(const auto* t: T){
+        MetricsAcc& all = groups[0].acc;
+        all.push(*t);
+        groups[t->isBuy ? 1 : 2].acc.push(*t);
+        const std::string day = day_of(t->exitTs!=TS_NONE ? t->exitTs : t->entryTs);
+        if(!day.empty()) days[day].push(*t);
+        bySymbol[t->symbol].push_back(t);
+        if(t->outcome!=TradeOutcome::Profit && t->outcome!=TradeOutcome::Loss) continue;
+        eq.field(t->exitTs==TS_NONE ? std::string() : format_wall(t->exitTs, TsLayout{}));
+        eq.field(t->trigger);
+        eq.field(t->symbol);
+        eq.field(t->isBuy ? "Buy" : "Sell");
+        eq.number(std::isnan(t->pl) ? 0.0 : t->pl, PRICE_DECIMALS);
+        eq.number(all.equity, PRICE_DECIMALS);
+        eq.number(all.peak - all.equity, PRICE_DECIMALS);
+        eq.end_row();
+    }
+    if(!eq.close()) std::cerr<<"❌ Write failed: "<<equityPath<<"\n";
+    for(auto& [day, acc]: days) groups.push_back({"day", day, acc});
+
+    // symbols: each its own equity curve, computed in parallel
+    std::vector<const std::vector<const TradeRecord*>*> symTrades;
+    const size_t firstSym = groups.size();
+    for(const auto& [sym, ts]: bySymbol){
+        groups.push_back({"symbol", sym, {}});
+        symTrades.push_back(&ts);
+    }
+    parallel_for(symTrades.size(), threads, [&](size_t k){
+        MetricsAcc& acc = groups[firstSym+k].acc;
+        for(const auto* t: *symTrades[k]) acc.push(*t);
     });
-    writeCSV(merged, H, rows); // keep merged as-is
 
-    bool isBuy = tolower_str(merged).find("buy")!=std::string::npos;
-    bool isSell= tolower_str(merged).find("sell")!=std::string::npos;
-    if(!isBuy && !isSell){
-        std::cerr<<"⚠️ Cannot infer side for "<<merged<<"\n";
+    const std::string path = (fs::path(dir)/"Metrics.csv").string();
+    CsvWriter out;
+    if(!out.open(path)){
+        std::cerr<<"❌ Cannot write "<<path<<"\n";
+        return;
+    }
+    out.row({"group","key","trades","entered","profit_hits","loss_hits","open","win_rate","total_pl","avg_pl",
+             "avg_win","avg_loss","profit_factor","sharpe","sortino","max_drawdown","best","worst"});
+    auto ratio=[](double a, double b){ return b>0 ? a/b : NAN; };
+    for(const auto& g: groups){
+        const MetricsAcc& a = g.acc;
+        const size_t n = a.closed();
+        out.field(g.kind);
+        out.field(g.key);
+        out.integer((int64_t)a.trades);
+        out.integer((int64_t)a.entered);
+        out.integer((int64_t)a.profit);
+        out.integer((int64_t)a.loss);
+        out.integer((int64_t)a.open);
+        out.number(ratio((double)a.profit, (double)n), PRICE_DECIMALS);
+        out.number(a.total, PRICE_DECIMALS);
+        out.number(n ? a.mean : NAN, PRICE_DECIMALS);
+        out.number(ratio(a.grossWin, (double)a.wins), PRICE_DECIMALS);
+        out.number(a.losses ? -a.grossLoss/a.losses : NAN, PRICE_DECIMALS);
+        out.number(ratio(a.grossWin, a.grossLoss), PRICE_DECIMALS);
+        out.number(a.sharpe(), PRICE_DECIMALS);
+        out.number(a.sortino(), PRICE_DECIMALS);
+        out.number(a.maxDD, PRICE_DECIMALS);
+        out.number(a.best, PRICE_DECIMALS);
+        out.number(a.worst, PRICE_DECIMALS);
+        out.end_row();
+    }
+    if(!out.close()){
+        std::cerr<<"❌ Write failed: "<<path<<"\n";
         return;
     }
+    const MetricsAcc& all = groups[0].acc;
+    char buf[160];
+    std::snprintf(buf, sizeof buf, "📈 %zu closed trade(s): win rate %.1f%%, P/L %s, max drawdown %s, Sharpe %s per trade\n",
+                  all.closed(), all.closed() ? 100.0*all.profit/all.closed() : 0.0,
+                  format_price(all.total).c_str(), format_price(all.maxDD).c_str(),
+                  std::isnan(all.sharpe()) ? "n/a" : csv_format_tick(all.sharpe(), 3).c_str());
+    std::cout<<buf<<"✅ Metrics → "<<path<<" (+ Equity.csv)\n";
+}
 
-    PTIdx idx = find_pt_indices(H, isBuy);
-    ensure_pt_cols(H, rows, isBuy, idx);
+// ───────────────────────────── resolve-only pipeline (Attempt 1)
+// `unresolvedPath` names the seed file (side is inferred from it); rows come in memory
+static void resolve_only_pipeline(const std::string& unresolvedPath,
+                                  CsvTable t,
+                                  const std::string& outDir,
+                                  const OhlcvPartitions& data,
+                                  TradeBook& trades)
+{
+    prepare_rows(t.H, t.rows);
 
-    auto rr = resolve_rows(isBuy, H, rows);
+    bool isBuy=false;
+    if(!infer_side(unresolvedPath, isBuy)) return;
 
-    // Drag-fill PT columns after resolution
-    PTIdx idx2 = find_pt_indices(H, isBuy);
-    forward_fill_indices(rows, {idx2.openCol, idx2.qCol, idx2.rCol, idx2.plCol}, (int)H.size());
+    auto rr = resolve_and_fill(isBuy, t.H, t.rows);
+
+    const std::string baseStem = strip_derivative_suffixes(fs::path(unresolvedPath).stem().string());
+    std::string out = (fs::path(outDir)/(baseStem + (rr.filled? "_Resolved.csv":"_Unresolved.csv"))).string();
+    writeCSV(out, t.H, t.rows);
+    // bars are only needed (and routed) for a trade the own rows already closed
+    const OhlcvStore* store = rr.filled && rr.open_idx>=0 ? &route_trigger(data, t.H, t.rows, baseStem) : nullptr;
+    trades.put(trade_record(baseStem, isBuy, t.H, t.rows, rr, store));
+    row_pool().give(t.rows);
+}
+
+// ───────────────────────────── merge+resolve pipeline (Attempts 2+)
+// Unresolved trigger file (rows in `left`) + OHLCV bars [first,last) merged, prepared
+// and resolved in memory. With `audit`, the merged table is also kept as <base>_Merged.csv.
+// Returns false when nothing was written (unknown side).
+static bool union_merge_and_resolve(const std::string& leftUnresolved,
+                                    const CsvTable& left,
+                                    const OhlcvStore& store, size_t first, size_t last,
+                                    const std::string& outDir,
+                                    bool audit,
+                                    TradeBook& trades,
+                                    ResolveResult& out_rr)
+{
+    std::string baseStem = strip_derivative_suffixes(fs::path(leftUnresolved).stem().string());
+    std::string merged   = (fs::path(outDir)/(baseStem+"_Merged.csv")).string();
+
+    CsvTable t;
+    t.rows.reserve(left.rows.size() + (last>first ? last-first : 0));
+    merge_union_stream({table_input(left.H, left.rows, false), window_input(store, first, last)}, t.H,
+                       [&](std::vector<std::string>& r){ t.rows.push_back(std::move(r)); });
+
+    // normalize + ensure chronological order + forward-fill again
+    prepare_rows(t.H, t.rows);
+    if(audit) writeCSV(merged, t.H, t.rows);
+
+    bool isBuy=false;
+    if(!infer_side(merged, isBuy)) return false;
+
+    auto rr = resolve_and_fill(isBuy, t.H, t.rows);
 
     std::string out = merged.substr(0, merged.size()-4) +
                       (rr.filled? "_Resolved.csv":"_Unresolved.csv");
-    normalize_id_name_inplace(H, rows);
-    writeCSV(out, H, rows);
+    writeCSV(out, t.H, t.rows);
+    trades.put(trade_record(baseStem, isBuy, t.H, t.rows, rr, &store));
+    row_pool().give(t.rows);
 
-    // If resolved, prune sibling unresolved for same base
+    out_rr = rr;
+    return true;
+}
+// Directory bookkeeping after a merge: a resolved base drops its unresolved
+// siblings; an unresolved first-time (non-merged) input is replaced by its merge.
+// Runs serially, after every trigger of the attempt has been resolved.
+static void prune_after_merge(const std::string& leftUnresolved, bool filled, const std::string& outDir){
     const std::string baseKey=base_key_from_path(leftUnresolved);
-    if(rr.filled){
+    if(filled){
         for(auto& f: fs::directory_iterator(outDir)){
             if(!f.is_regular_file()) continue;
             std::string fn=f.path().filename().string();
@@ -890,142 +2309,1628 @@ static int end_off_for_attempt(int attempt){
 }
 
 // ───────────────────────────── attempt loop
+// One input file of an attempt. Attempt 1 resolves a raw trigger on its own rows;
+// later attempts merge an *_Unresolved file with its next OHLCV window. Returns
+// true when a merge ran (its result then needs prune_after_merge).
+static bool attempt_one(int attempt, const fs::path& path, const std::string& outDir,
+                        const OhlcvPartitions& data, bool audit, TradeBook& trades, ResolveResult& rr)
+{
+    const std::string name=path.filename().string();
+    const std::string lname=tolower_str(name);
+
+    if(attempt==1){
+        // raw rows seed *_Unresolved (written out only when auditing)
+        std::ifstream in(path);
+        if(!in) return false;
+        std::string head;
+        if(!std::getline(in, head)) return false;
+        CsvTable t;
+        t.H=splitCSV(head);
+        std::string line;
+        while(std::getline(in,line)) if(!line.empty()) t.rows.push_back(split_pooled(line));
+        in.close();
+        for(auto& r: t.rows) r.resize(t.H.size());
+
+        std::string outUnres=(fs::path(outDir)/(path.stem().string()+"_Unresolved.csv")).string();
+        if(audit) writeCSV_raw(outUnres, t.H, t.rows);
+
+        // resolve-only on attempt 1
+        resolve_only_pipeline(outUnres, std::move(t), outDir, data, trades);
+        return false;
+    }
+
+    // window bounds from base time (filename or last timestamp)
+    std::time_t base_et{};
+    if(!trade_time_from_filename_ET(name, base_et)){
+        std::string dummy;
+        if(!last_et_timestamp_in_csv(path.string(), base_et, dummy)){
+            log_line(std::cerr, "⚠️ No trade time for "+name+"\n");
+            return false;
+        }
+    }
+    int end_off = end_off_for_attempt(attempt);
+    bool mergedUnresolved = (lname.find("_merged")!=std::string::npos);
+    std::time_t start_et, end_et;
+    if(mergedUnresolved){
+        int prev_end = end_off_for_attempt(attempt-1);
+        start_et = base_et + (prev_end+1)*60;
+        end_et   = base_et + end_off*60;
+    }else{
+        start_et = base_et + START_OFFSET_MIN*60; // +3
+        end_et   = base_et + end_off*60;          // attempt 2 → +5; attempt 3 → +8; ...
+    }
+
+    // slice the window out of the trigger's instrument partition
+    if(!data.ok()){
+        log_line(std::cerr, "❌ OHLCV missing\n");
+        return false;
+    }
+    CsvTable left;
+    if(!read_csv_rows(path.string(), left.H, left.rows)) return false;
+    const OhlcvStore& store = route_trigger(data, left.H, left.rows, name);
+    size_t first=0, last=0;
+    ohlcv_window(store, start_et, end_et, first, last);
+
+    if(audit){
+        std::string winPath=(fs::path(outDir)/(strip_derivative_suffixes(path.stem().string())+
+                             "_Next"+std::to_string(end_off)+"Min.csv")).string();
+        write_window_csv(winPath, store, first, last);
+    }
+
+    // merge + resolve
+    const bool merged = union_merge_and_resolve(path.string(), left, store, first, last, outDir, audit, trades, rr);
+    row_pool().give(left.rows);
+    return merged;
+}
+
+// Inputs are listed up front (name order) and resolved on the worker pool; the
+// directory bookkeeping then runs serially in the same order, so the output does
+// not depend on the thread count. `audit` also keeps the intermediate CSVs
+// (seed copy, OHLCV window, merged table).
 static void attempt_process(int attempt,
                             const std::string& inDir,
                             const std::string& outDir,
-                            const std::string& ohlcvPath)
+                            const OhlcvPartitions& data,
+                            bool audit,
+                            unsigned threads,
+                            TradeBook& trades)
 {
     fs::create_directories(outDir);
     bool first=(attempt==1);
 
+    std::vector<fs::path> inputs;
     for(auto& e: fs::directory_iterator(inDir)){
         if(!e.is_regular_file() || e.path().extension()!=".csv") continue;
         const std::string name=e.path().filename().string();
-        const std::string lname=tolower_str(name);
-
-        if(first){
-            // ONLY raw triggers; no merging on attempt 1
-            if(lname.find("_merged")!=std::string::npos || lname.find("_next")!=std::string::npos ||
-               lname.find("_resolved")!=std::string::npos || lname.find("_unresolved")!=std::string::npos)
-                continue;
-
-            // copy raw → *_Unresolved.csv
-            std::ifstream in(e.path());
-            if(!in) continue;
-            std::string head;
-            if(!std::getline(in, head)){ in.close(); continue; }
-            auto H=splitCSV(head);
-            std::vector<std::vector<std::string>> rows;
-            std::string line;
-            while(std::getline(in,line)) if(!line.empty()) rows.push_back(splitCSV(line));
-            in.close();
-
-            std::string outUnres=(fs::path(outDir)/(e.path().stem().string()+"_Unresolved.csv")).string();
-            writeCSV(outUnres,H,rows);
-
-            // resolve-only on attempt 1
-            resolve_only_pipeline(outUnres, outDir);
+        // attempt 1: ONLY raw triggers (no merging); later attempts: *_Unresolved.csv only
+        if(first ? !is_raw_trigger_name(name) : !is_unresolved_name(name)) continue;
+        inputs.push_back(e.path());
+    }
+    std::sort(inputs.begin(), inputs.end());
+
+    std::vector<ResolveResult> rr(inputs.size());
+    std::vector<char> merged(inputs.size(), 0);
+    parallel_for(inputs.size(), threads, [&](size_t k){
+        merged[k] = attempt_one(attempt, inputs[k], outDir, data, audit, trades, rr[k]);
+    });
+    for(size_t k=0;k<inputs.size();++k)
+        if(merged[k]) prune_after_merge(inputs[k].string(), rr[k].filled, outDir);
+}
+
+// ───────────────────────────── trigger inputs (Trigger_Windows files or Static_Data rows)
+// A trigger is either a raw Trigger_Windows file or a row of Static_Data.csv that
+// fired. A Static_Data row is turned into the table its Trigger_Windows file would
+// hold: the row itself (ts_event = trade time, Type = side) followed by the bars of
+// its first START_OFFSET_MIN minutes. The table is built when the trigger is
+// processed, so no per-trigger files are needed.
+struct TriggerInput{
+    fs::path file;                   // raw trigger file; empty for Static_Data rows
+    std::string stem;                // Buy_/Sell_YYYYMMDD_HHMMSS for Static_Data rows
+    CsvTable record;                 // Static_Data row: header + one row
+    std::time_t base_et=0;           // Static_Data row: trade time
+};
+// Trade time of a trigger file: from its filename, else its last timestamp
+static bool trigger_base_time(const fs::path& raw, std::time_t& base_et){
+    if(trade_time_from_filename_ET(raw.filename().string(), base_et)) return true;
+    std::string dummy;
+    if(last_et_timestamp_in_csv(raw.string(), base_et, dummy)) return true;
+    log_line(std::cerr, "⚠️ No trade time for "+raw.filename().string()+"\n");
+    return false;
+}
+static bool trigger_input_time(const TriggerInput& in, std::time_t& base_et){
+    if(in.file.empty()){ base_et=in.base_et; return true; }
+    return trigger_base_time(in.file, base_et);
+}
+// The trigger's own rows, as Attempt 1 would read them, and its instrument partition
+static bool load_trigger_input(const TriggerInput& in, const OhlcvPartitions& data,
+                               std::vector<std::string>& H,
+                               std::vector<std::vector<std::string>>& rows,
+                               const OhlcvStore*& routed)
+{
+    if(!in.file.empty()){
+        if(!read_csv_rows(in.file.string(), H, rows)) return false;
+        for(auto& r: rows) r.resize(H.size());
+        routed = &route_trigger(data, H, rows, in.stem);
+        return true;
+    }
+    const OhlcvStore& store = route_trigger(data, in.record.H, in.record.rows, in.stem);
+    routed = &store;
+    size_t first=0, last=0;
+    ohlcv_window(store, in.base_et, in.base_et + START_OFFSET_MIN*60 - 1, first, last);
+    row_pool().give(rows);
+    rows.reserve(1 + last-first);
+    merge_union_stream({table_input(in.record.H, in.record.rows, false), window_input(store, first, last)}, H,
+                       [&](std::vector<std::string>& r){ rows.push_back(std::move(r)); });
+    return true;
+}
+
+static std::vector<fs::path> list_raw_triggers(const std::string& triggerDir){
+    std::vector<fs::path> raws;
+    for(auto& e: fs::directory_iterator(triggerDir)){
+        if(!e.is_regular_file() || e.path().extension()!=".csv") continue;
+        if(!is_raw_trigger_name(e.path().filename().string())) continue;
+        raws.push_back(e.path());
+    }
+    std::sort(raws.begin(), raws.end());
+    return raws;
+}
+static std::vector<TriggerInput> file_trigger_inputs(const std::string& triggerDir){
+    std::vector<TriggerInput> ins;
+    for(const auto& raw: list_raw_triggers(triggerDir)){
+        TriggerInput in;
+        in.file=raw; in.stem=raw.stem().string();
+        ins.push_back(std::move(in));
+    }
+    return ins;
+}
+
+// Trade time of a Static_Data row: a timestamp column, else Date + Time
+static bool sheet_trade_time(const std::vector<std::string>& H, const std::vector<std::string>& cols, TsCell& t){
+    auto cell=[&](int c){ return c>=0 && c<(int)cols.size() ? trim(cols[c]) : std::string(); };
+    int ts = find_by_synonyms(H, {"ts_event","timestamp","datetime","date time"});
+    if(ts>=0) return parse_ts_cell(cell(ts), t);
+    int d = find_by_synonyms(H, {"date","trade date"}), tm = find_by_synonyms(H, {"time","trade time"});
+    if(d<0 || tm<0) return false;
+    return parse_ts_cell(cell(d)+" "+cell(tm), t);
+}
+// Sheet columns kept for one side: the other side's "Buy ..." / "Sell ..." columns
+// are dropped so the level lookups (which match on substrings) see one side only.
+static std::vector<int> sheet_columns_for_side(const std::vector<std::string>& H, bool isBuy){
+    const std::string other = isBuy ? "sell" : "buy";
+    std::vector<int> keep;
+    for(int i=0;i<(int)H.size();++i)
+        if(norm_alnum(H[i]).rfind(other, 0)!=0) keep.push_back(i);
+    return keep;
+}
+// Every trigger of a Static_Data sheet, in sheet order (Buy before Sell on a row)
+static std::vector<TriggerInput> static_trigger_inputs(const std::string& sheetPath){
+    TriggerSheet sheet;
+    std::vector<int> keep[2];
+    std::vector<std::string> recH[2];
+    std::unordered_map<std::string,int> seen;
+    std::vector<TriggerInput> ins;
+    int untimed=0;
+    bool ok = for_each_static_trigger(sheetPath, sheet, [&](const std::vector<std::string>& cols, bool isBuy){
+        const int s = isBuy ? 0 : 1;
+        if(recH[s].empty()){
+            keep[s] = sheet_columns_for_side(sheet.header, isBuy);
+            recH[s].push_back("ts_event");
+            for(int c: keep[s]) recH[s].push_back(sheet.header[c]);
+            recH[s].push_back("Type");
+        }
+        TsCell t;
+        if(!sheet_trade_time(sheet.header, cols, t)){ ++untimed; return; }
+        const int64_t et_wall = t.utc ? (int64_t)utc_to_et((std::time_t)t.wall) : t.wall;
+
+        TriggerInput in;
+        in.base_et = et_epoch_from_wall(et_wall);
+        std::string when = format_wall(et_wall, TsLayout{});             // YYYY-MM-DD HH:MM:SS
+        std::string stamp = when.substr(0,4)+when.substr(5,2)+when.substr(8,2)+"_"+
+                            when.substr(11,2)+when.substr(14,2)+when.substr(17,2);
+        in.stem = (isBuy ? "Buy_" : "Sell_") + stamp;
+        int dup = ++seen[in.stem];
+        if(dup>1) in.stem += "_"+std::to_string(dup);
+
+        std::vector<std::string> row{when};
+        for(int c: keep[s]) row.push_back(c<(int)cols.size() ? trim(cols[c]) : std::string());
+        row.push_back(isBuy ? "Buy" : "Sell");
+        in.record.H = recH[s];
+        in.record.rows.push_back(std::move(row));
+        ins.push_back(std::move(in));
+    });
+    if(!ok) throw std::runtime_error("Cannot read triggers from "+sheetPath);
+    if(untimed) std::cerr<<"⚠️ "<<untimed<<" Static_Data trigger(s) without a Date/Time skipped\n";
+    std::cout<<"✅ "<<ins.size()<<" trigger(s) from "<<sheetPath<<"\n";
+    return ins;
+}
+// Attempt 1 seeds: each Static_Data trigger written as the raw file the attempt loop reads
+static void write_trigger_seeds(const std::vector<TriggerInput>& ins, const OhlcvPartitions& data, const std::string& dir){
+    for(const auto& in: ins){
+        CsvTable t;
+        const OhlcvStore* store = nullptr;
+        if(!load_trigger_input(in, data, t.H, t.rows, store)) continue;
+        const std::string path = (fs::path(dir)/(in.stem+".csv")).string();
+        CsvWriter out;
+        if(!out.open(path)){
+            std::cerr<<"❌ Cannot write "<<path<<"\n";
             continue;
         }
+        out.row(t.H);
+        for(const auto& r: t.rows) out.row(r);
+        if(!out.close()) std::cerr<<"❌ Write failed: "<<path<<"\n";
+    }
+}
+
+// ───────────────────────────── forward-scan resolver (one pass, no Attempt_N files)
+// A raw trigger is first resolved on its own rows (as Attempt 1 does). If still
+// open, its entry state is carried into the OHLCV bars from base+START_OFFSET_MIN
+// up to the horizon (0 = to the end of the data). Only the final
+// *_Resolved / *_Unresolved file is written.
+struct TriggerJob{
+    std::string stem;
+    bool isBuy=false;
+    std::vector<std::string> H;                  // trigger rows, prepared + resolved on their own
+    std::vector<std::vector<std::string>> rows;
+    ResolveResult rr;
+    bool scan=false;                             // still open and has levels + a trade time
+    TradeLevels L;
+    size_t first=0, last=0;                      // OHLCV bars [first,last) inside the horizon
+    std::time_t start_et=0, end_et=0;            // the same window as ET times
+    std::string outName;                         // file written by write_trigger_job
+    uint64_t key=0;                              // result-cache key (0 = not cached)
+    const OhlcvStore* store=nullptr;             // the trigger's instrument partition
+    TradeRecord trade;                           // set by write_trigger_job (or a cache replay)
+};
+// Bars a trigger scans: from base+START_OFFSET_MIN up to the horizon (0 = no limit)
+static void trigger_scan_times(std::time_t base_et, int horizon_min, std::time_t& start_et, std::time_t& end_et){
+    start_et = base_et + START_OFFSET_MIN*60;
+    end_et   = horizon_min>0 ? base_et + (std::time_t)horizon_min*60
+                             : std::numeric_limits<std::time_t>::max();
+}
+static void trigger_scan_window(const OhlcvStore& store, std::time_t base_et, int horizon_min,
+                                size_t& first, size_t& last){
+    std::time_t start_et, end_et;
+    trigger_scan_times(base_et, horizon_min, start_et, end_et);
+    ohlcv_window(store, start_et, end_et, first, last);
+}
+static bool load_trigger_job(const TriggerInput& in, const OhlcvPartitions& data, TriggerJob& job){
+    job = TriggerJob{};
+    job.stem = in.stem;
+    return load_trigger_input(in, data, job.H, job.rows, job.store);
+}
+// Resolve the loaded rows on their own and, if still open, set up the bar scan
+static bool plan_trigger_job(const TriggerInput& in, int horizon_min, TriggerJob& job){
+    const OhlcvStore& store = *job.store;
+    prepare_rows(job.H, job.rows);
+    if(!infer_side(job.stem, job.isBuy)) return false;
+
+    job.rr = resolve_and_fill(job.isBuy, job.H, job.rows);
+    if(job.rr.filled || !store.ok) return true;
+
+    const LevelCols& c = header_schema(job.H).level[job.isBuy];
+    if(!level_cols_ok(c) || !find_trade_levels(c, job.rows, job.L)) return true;
+
+    std::time_t base_et{};
+    if(!trigger_input_time(in, base_et)) return true;
+    trigger_scan_times(base_et, horizon_min, job.start_et, job.end_et);
+    ohlcv_window(store, job.start_et, job.end_et, job.first, job.last);
+    job.scan = true;
+    return true;
+}
+// Write the job's final file; stop_at is one past the last bar that was scanned
+static ResolveResult write_trigger_job(TriggerJob& job, size_t stop_at, const std::string& outDir){
+    const OhlcvStore& store = *job.store;
+    if(!job.scan){
+        job.outName = job.stem+(job.rr.filled? "_Resolved.csv":"_Unresolved.csv");
+        writeCSV((fs::path(outDir)/job.outName).string(), job.H, job.rows);
+        job.trade = trade_record(job.stem, job.isBuy, job.H, job.rows, job.rr, job.store);
+        return job.rr;
+    }
+    // materialize trigger rows + scanned bars once, in the same layout as the attempt loop
+    RowPool& pool = row_pool();
+    Rows bars;
+    bars.reserve(stop_at-job.first);
+    for(size_t i=job.first;i<stop_at;++i){
+        bars.push_back(pool.take());
+        bar_row_into(store, i, bars.back());
+    }
 
-        // later attempts: process *_Unresolved.csv only
-        if(!is_unresolved_name(name)) continue;
+    std::vector<std::string> MH;
+    std::vector<std::vector<std::string>> MR;
+    merge_union_rows(job.H, job.rows, store.header, bars, MH, MR);
+    prepare_rows(MH, MR);
+    auto mr = resolve_and_fill(job.isBuy, MH, MR);
+
+    job.outName = job.stem+(mr.filled? "_Merged_Resolved.csv":"_Merged_Unresolved.csv");
+    writeCSV((fs::path(outDir)/job.outName).string(), MH, MR);
+    job.trade = trade_record(job.stem, job.isBuy, MH, MR, mr, &store);
+    pool.give(bars);
+    pool.give(MR);
+    return mr;
+}
+// First-crossing queries on the extrema index: entry, then the first profit and
+// stop-loss touch after it (profit wins a same-bar tie). Returns stop_at.
+static size_t forward_scan_job(const TriggerJob& job){
+    const OhlcvStore& store = *job.store;
+    const TradeLevels& L = job.L;
+    size_t i = job.first, end = job.last;
+    if(job.rr.open_idx==-1){
+        size_t e = job.isBuy ? first_high_at_or_above(store, i, end, L.stop)
+                             : first_low_at_or_below (store, i, end, L.stop);
+        if(e>=end) return end;
+        i = e+1;
+    }
+    size_t p = job.isBuy ? first_high_at_or_above(store, i, end, L.profit)
+                         : first_low_at_or_below (store, i, end, L.profit);
+    size_t l = job.isBuy ? first_low_at_or_below (store, i, p, L.loss)
+                         : first_high_at_or_above(store, i, p, L.loss);
+    if(l<p)   return l+1;
+    if(p<end) return p+1;
+    return end;
+}
+
+// ───────────────────────────── result cache (incremental scan / sweep runs)
+// One entry per trigger, named by an FNV-1a hash of its name and rows, the
+// resolver parameters and the bar layout. An entry also records which bars the
+// result depended on: the scanned part of the window for a resolved trade, the
+// whole window for one left open, none when the trigger's own rows decided it.
+// It is replayed only when those bars still hash the same, so triggers whose
+// bars were added or changed are resolved again and everything else is copied.
+// Entries whose key no trigger of the run asked for (the trigger is gone, or the
+// parameters changed) are removed when the run ends.
+static constexpr uint64_t FNV_OFFSET = 1469598103934665603ull;
+static constexpr uint64_t FNV_PRIME  = 1099511628211ull;
+static inline void fnv1a_bytes(uint64_t& h, std::string_view s){
+    for(unsigned char c: s){ h ^= c; h *= FNV_PRIME; }
+    h ^= 0xff; h *= FNV_PRIME;                        // field terminator
+}
+static inline void fnv1a_word(uint64_t& h, uint64_t w){ h ^= w; h *= FNV_PRIME; }
+static inline uint64_t bits_of(double v){ uint64_t w; std::memcpy(&w, &v, sizeof w); return w; }
+
+static constexpr char     RESULT_CACHE_MAGIC[4] = {'O','J','R','C'};
+static constexpr uint32_t RESULT_CACHE_VERSION  = 5;   // bump when resolver rules or output layout change
+
+enum class ResultDeps : uint32_t { OwnRows, Prefix, Window };
+struct ResultEntryHeader{
+    char     magic[4];
+    uint32_t version;
+    uint32_t deps;         // ResultDeps
+    uint32_t filled;
+    uint64_t bars;         // bars from the window start the result depends on
+    uint64_t barsHash;
+    uint32_t side, outcome;                       // trade record (TradeRecord without its names)
+    int64_t  entryTs, exitTs, holdBars;
+    double   entryPrice, exitPrice, pl;
+    uint64_t nameLen;      // output name suffix (after the stem), then the symbol, then the file bytes
+    uint64_t symbolLen;
+    uint64_t bodyLen;
+};
+
+struct ResultCache{
+    std::string dir;
+    uint64_t params=FNV_OFFSET;                 // resolver parameters + bar layout
+    std::unordered_map<const OhlcvStore*, std::vector<uint64_t>> barHash;   // per partition, one per bar
+    std::atomic<size_t> hits{0};
+    std::mutex m;
+    std::unordered_set<uint64_t> live;          // keys looked up by this run
+};
+// Hash bars [from, end) of a partition (every column) into its barHash
+static void extend_bar_hashes(ResultCache& rc, const OhlcvStore& store, size_t from, unsigned threads){
+    const BarTable& b = store.bars;
+    std::vector<uint64_t> pooled(b.pool.strs.size(), FNV_OFFSET);
+    for(size_t i=0;i<pooled.size();++i) fnv1a_bytes(pooled[i], b.pool.strs[i]);
+    auto& bh = rc.barHash[&store];
+    const size_t n = b.size(), BLOCK = 1<<16;
+    bh.resize(n, 0);
+    if(from>=n) return;
+    parallel_for((n-from+BLOCK-1)/BLOCK, threads, [&](size_t k){
+        for(size_t i=from+k*BLOCK; i<std::min(n, from+(k+1)*BLOCK); ++i){
+            uint64_t x = FNV_OFFSET;
+            fnv1a_word(x, (uint64_t)b.ts[i]);
+            for(size_t j=0;j<b.nText;++j) fnv1a_bytes(x, b.text_cell(i, j));
+            fnv1a_word(x, bits_of(b.open[i]));    fnv1a_word(x, bits_of(b.high[i]));
+            fnv1a_word(x, bits_of(b.low[i]));     fnv1a_word(x, bits_of(b.close[i]));
+            fnv1a_word(x, (uint64_t)b.volume[i]);
+            fnv1a_word(x, pooled[b.rtype[i]]);      fnv1a_word(x, pooled[b.publisher[i]]);
+            fnv1a_word(x, pooled[b.instrument[i]]); fnv1a_word(x, pooled[b.symbol[i]]);
+            bh[i] = x;
+        }
+    });
+}
+static void open_result_cache(ResultCache& rc, const std::string& dir, const OhlcvPartitions& data,
+                              int horizon_min, unsigned threads)
+{
+    const OhlcvStore& layout = data.none;        // header, columns and formatting shared by every partition
+    rc.dir = dir;
+    fs::create_directories(dir);
+    uint64_t& h = rc.params;
+    fnv1a_word(h, RESULT_CACHE_VERSION);
+    fnv1a_word(h, bits_of(SLIPPAGE));
+    fnv1a_word(h, (uint64_t)START_OFFSET_MIN);
+    fnv1a_word(h, (uint64_t)horizon_min);
+    fnv1a_word(h, (uint64_t)g_row_offset);
+    fnv1a_word(h, data.ok());
+    for(const auto& c: layout.header) fnv1a_bytes(h, c);
+    for(BarCol c: layout.cols) fnv1a_word(h, (uint64_t)c);
+    const BarTable& b = layout.bars;
+    for(int d: b.decimals) fnv1a_word(h, (uint64_t)d);
+
+    for(const auto& st: data.parts) extend_bar_hashes(rc, st, 0, threads);
+}
+static uint64_t bar_range_hash(const ResultCache& rc, const OhlcvStore& store, size_t first, size_t n){
+    uint64_t h = FNV_OFFSET;
+    fnv1a_word(h, n);
+    if(n==0) return h;
+    const auto& bh = rc.barHash.at(&store);
+    for(size_t i=first;i<first+n;++i) fnv1a_word(h, bh[i]);
+    return h;
+}
+static std::string result_entry_path(const ResultCache& rc, uint64_t key){
+    char name[32]; std::snprintf(name, sizeof name, "%016llx.res", (unsigned long long)key);
+    return (fs::path(rc.dir)/name).string();
+}
+// Key of a loaded (not yet prepared) job
+static uint64_t result_key(const ResultCache& rc, const TriggerJob& job){
+    uint64_t h = rc.params;
+    fnv1a_bytes(h, job.stem);
+    fnv1a_word(h, job.H.size());
+    for(const auto& c: job.H) fnv1a_bytes(h, c);
+    fnv1a_word(h, job.rows.size());
+    for(const auto& r: job.rows) for(const auto& c: r) fnv1a_bytes(h, c);
+    return h;
+}
+// Write the cached output of a loaded job if its entry is still valid. With
+// `closedOnly`, a result left open is replayed only once a bar past its window exists.
+static bool replay_cached_result(ResultCache& rc, const TriggerInput& in, int horizon_min,
+                                 TriggerJob& job, const std::string& outDir, bool& filled,
+                                 bool closedOnly=false)
+{
+    const OhlcvStore& store = *job.store;
+    job.key = result_key(rc, job);
+    {
+        std::lock_guard<std::mutex> lk(rc.m);
+        rc.live.insert(job.key);
+    }
+    std::ifstream f(result_entry_path(rc, job.key), std::ios::binary);
+    ResultEntryHeader eh{};
+    if(!f || !f.read((char*)&eh, sizeof eh)) return false;
+    if(std::memcmp(eh.magic, RESULT_CACHE_MAGIC, 4)!=0 || eh.version!=RESULT_CACHE_VERSION) return false;
 
-        // window bounds from base time (filename or last timestamp)
+    if((ResultDeps)eh.deps!=ResultDeps::OwnRows){
         std::time_t base_et{};
-        if(!trade_time_from_filename_ET(name, base_et)){
-            std::string dummy;
-            if(!last_et_timestamp_in_csv(e.path().string(), base_et, dummy)){
-                std::cerr<<"⚠️ No trade time for "<<name<<"\n";
-                continue;
-            }
+        if(!trigger_input_time(in, base_et)) return false;
+        size_t first=0, last=0;
+        trigger_scan_window(store, base_et, horizon_min, first, last);
+        size_t n = last-first;
+        if((ResultDeps)eh.deps==ResultDeps::Window ? n!=eh.bars : n<eh.bars) return false;
+        if(closedOnly && (ResultDeps)eh.deps==ResultDeps::Window && last>=store.bars.size()) return false;
+        if(bar_range_hash(rc, store, first, (size_t)eh.bars)!=eh.barsHash) return false;
+    }
+    std::string suffix((size_t)eh.nameLen, '\0'), symbol((size_t)eh.symbolLen, '\0'), body((size_t)eh.bodyLen, '\0');
+    if(!f.read(suffix.data(), (std::streamsize)suffix.size()) || !f.read(symbol.data(), (std::streamsize)symbol.size()) ||
+       !f.read(body.data(), (std::streamsize)body.size()))
+        return false;
+    job.outName = job.stem+suffix;
+    TradeRecord& t = job.trade;
+    t.trigger = job.stem; t.symbol = symbol;
+    t.isBuy = eh.side!=0; t.outcome = (TradeOutcome)eh.outcome;
+    t.entryTs = eh.entryTs; t.exitTs = eh.exitTs; t.bars = eh.holdBars;
+    t.entryPrice = eh.entryPrice; t.exitPrice = eh.exitPrice; t.pl = eh.pl;
+    std::ofstream out(fs::path(outDir)/job.outName, std::ios::binary);
+    if(!out || !out.write(body.data(), (std::streamsize)body.size())) return false;
+    filled = eh.filled!=0;
+    ++rc.hits;
+    return true;
+}
+// Record a freshly written job (stop_at as passed to write_trigger_job)
+static void store_result(const ResultCache& rc, const TriggerJob& job, size_t stop_at, bool filled,
+                         const std::string& outDir)
+{
+    if(job.outName.empty()) return;
+    std::ifstream in(fs::path(outDir)/job.outName, std::ios::binary);
+    if(!in) return;
+    std::ostringstream ss; ss<<in.rdbuf();
+    const std::string body = ss.str(), suffix = job.outName.substr(job.stem.size());
+
+    ResultEntryHeader eh{};
+    std::memcpy(eh.magic, RESULT_CACHE_MAGIC, 4);
+    eh.version = RESULT_CACHE_VERSION;
+    ResultDeps deps = !job.scan ? ResultDeps::OwnRows : filled ? ResultDeps::Prefix : ResultDeps::Window;
+    eh.deps    = (uint32_t)deps;
+    eh.filled  = filled;
+    eh.bars    = deps==ResultDeps::OwnRows ? 0 : stop_at-job.first;   // an open result scanned its whole window
+    eh.barsHash= bar_range_hash(rc, *job.store, job.first, (size_t)eh.bars);
+    const TradeRecord& t = job.trade;
+    eh.side = t.isBuy; eh.outcome = (uint32_t)t.outcome;
+    eh.entryTs = t.entryTs; eh.exitTs = t.exitTs; eh.holdBars = t.bars;
+    eh.entryPrice = t.entryPrice; eh.exitPrice = t.exitPrice; eh.pl = t.pl;
+    eh.nameLen = suffix.size();
+    eh.symbolLen = t.symbol.size();
+    eh.bodyLen = body.size();
+
+    // write-then-rename, so a reader never sees a half-written entry
+    const std::string path = result_entry_path(rc, job.key);
+    const std::string tmp  = path+".tmp"+std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    bool ok;
+    {
+        std::ofstream f(tmp, std::ios::binary);
+        f.write((const char*)&eh, sizeof eh);
+        f.write(suffix.data(), (std::streamsize)suffix.size());
+        f.write(t.symbol.data(), (std::streamsize)t.symbol.size());
+        f.write(body.data(), (std::streamsize)body.size());
+        ok = (bool)f;
+    }
+    std::error_code ec;
+    if(ok) fs::rename(tmp, path, ec);
+    if(!ok || ec) fs::remove(tmp, ec);
+}
+
+// Remove the entries this run did not look up, and temp files left by a killed run
+static void prune_result_cache(ResultCache& rc){
+    size_t removed=0;
+    std::error_code ec;
+    for(auto& e: fs::directory_iterator(rc.dir, ec)){
+        if(!e.is_regular_file()) continue;
+        const std::string fn = e.path().filename().string();
+        bool stale = fn.find(".res.tmp")!=std::string::npos;
+        if(!stale && fn.size()==20 && fn.compare(16, 4, ".res")==0){
+            uint64_t key=0;
+            auto r = std::from_chars(fn.data(), fn.data()+16, key, 16);
+            stale = r.ec==std::errc() && r.ptr==fn.data()+16 && !rc.live.count(key);
         }
-        int end_off = end_off_for_attempt(attempt);
-        bool mergedUnresolved = (lname.find("_merged")!=std::string::npos);
-        std::time_t start_et, end_et;
-        if(mergedUnresolved){
-            int prev_end = end_off_for_attempt(attempt-1);
-            start_et = base_et + (prev_end+1)*60;
-            end_et   = base_et + end_off*60;
+        if(stale && fs::remove(e.path(), ec)) ++removed;
+    }
+    if(removed) std::cout<<"🧹 Removed "<<removed<<" stale result cache entr"<<(removed==1 ? "y" : "ies")<<" from "<<rc.dir<<"\n";
+}
+
+// Run summary; `cache` may be null
+static void report_resolved(const char* what, const std::vector<char>& filled, size_t total,
+                            int horizon_min, const ResultCache* cache)
+{
+    int resolved=(int)std::count(filled.begin(), filled.end(), 1);
+    std::cout<<"\n🎯 "<<what<<": "<<resolved<<"/"<<total<<" trade(s) resolved";
+    if(horizon_min>0) std::cout<<" within "<<horizon_min<<" min";
+    if(cache) std::cout<<" ("<<cache->hits<<" from the result cache)";
+    std::cout<<".\n";
+}
+
+static void forward_scan_process(const std::vector<TriggerInput>& triggers,
+                                 const std::string& outDir,
+                                 const OhlcvPartitions& data,
+                                 int horizon_min,
+                                 unsigned threads,
+                                 ResultCache* cache)
+{
+    fs::create_directories(outDir);
+
+    std::vector<char> filled(triggers.size(), 0);
+    TradeBook trades;
+    parallel_for(triggers.size(), threads, [&](size_t k){
+        TriggerJob job;
+        if(!load_trigger_job(triggers[k], data, job)) return;
+        bool hit=false;
+        if(cache && replay_cached_result(*cache, triggers[k], horizon_min, job, outDir, hit)){
+            filled[k]=hit;
+            trades.put(std::move(job.trade));
+            row_pool().give(job.rows);
+            return;
+        }
+        if(!plan_trigger_job(triggers[k], horizon_min, job)) return;
+        size_t stop_at = job.scan ? forward_scan_job(job) : 0;
+        filled[k] = write_trigger_job(job, stop_at, outDir).filled;
+        if(cache) store_result(*cache, job, stop_at, filled[k], outDir);
+        trades.put(std::move(job.trade));
+        row_pool().give(job.rows);
+    });
+    report_resolved("Forward scan", filled, triggers.size(), horizon_min, cache);
+    write_trades(trades, outDir);
+    write_metrics(trades, outDir, threads);
+}
+
+// ───────────────────────────── sweep-line engine (all triggers, one pass over the bars)
+// Pending entry stops and open exit levels sit in price-keyed books. Each bar pops
+// every level it crossed, so a bar costs O(fired·log n) instead of touching every
+// open trade. Same-bar rules match resolve_step: exits before entries (a trade
+// never exits on its entry bar) and profit before stop-loss.
+struct SweepEngine{
+    enum class Kind : unsigned char { Entry, Profit, Loss };
+    struct Ref{ size_t trade; Kind kind; };
+    using UpBook   = std::multimap<double, Ref>;                       // fires when high >= level
+    using DownBook = std::multimap<double, Ref, std::greater<double>>; // fires when low  <= level
+
+    struct Trade{
+        bool isBuy=false;
+        TradeLevels L;
+        bool open=false, done=false, filled=false, profit_hit=false;
+        size_t open_bar=0, stop_at=0;
+        bool has_up=false, has_dn=false;
+        UpBook::iterator up;
+        DownBook::iterator dn;
+    };
+
+    std::vector<Trade> trades;
+    UpBook   upBook;
+    DownBook dnBook;
+    size_t   active=0;
+    std::vector<Ref> fired;
+
+    size_t add(bool isBuy, const TradeLevels& L, bool open){
+        Trade t; t.isBuy=isBuy; t.L=L; t.open=open;
+        trades.push_back(t);
+        return trades.size()-1;
+    }
+    void place_up(size_t id, double lvl, Kind k){ auto& t=trades[id]; t.up=upBook.emplace(lvl, Ref{id,k}); t.has_up=true; }
+    void place_dn(size_t id, double lvl, Kind k){ auto& t=trades[id]; t.dn=dnBook.emplace(lvl, Ref{id,k}); t.has_dn=true; }
+    void place_orders(size_t id){
+        const auto& t=trades[id];
+        if(!t.open){
+            if(t.isBuy) place_up(id, t.L.stop, Kind::Entry);
+            else        place_dn(id, t.L.stop, Kind::Entry);
+        }else if(t.isBuy){
+            place_up(id, t.L.profit, Kind::Profit);
+            place_dn(id, t.L.loss,   Kind::Loss);
         }else{
-            start_et = base_et + START_OFFSET_MIN*60; // +3
-            end_et   = base_et + end_off*60;          // attempt 2 → +5; attempt 3 → +8; ...
+            place_dn(id, t.L.profit, Kind::Profit);
+            place_up(id, t.L.loss,   Kind::Loss);
+        }
+    }
+    void cancel_orders(size_t id){
+        auto& t=trades[id];
+        if(t.has_up){ upBook.erase(t.up); t.has_up=false; }
+        if(t.has_dn){ dnBook.erase(t.dn); t.has_dn=false; }
+    }
+    void activate(size_t id){ place_orders(id); ++active; }
+    void finish(size_t id, size_t stop_at, bool filled, bool profit){
+        auto& t=trades[id];
+        cancel_orders(id);
+        t.done=true; t.filled=filled; t.profit_hit=profit; t.stop_at=stop_at;
+        --active;
+    }
+    void on_bar(size_t i, double hi, double lo){
+        fired.clear();
+        for(auto it=upBook.begin(); it!=upBook.end() && it->first<=hi; it=upBook.erase(it)){
+            fired.push_back(it->second); trades[it->second.trade].has_up=false;
+        }
+        for(auto it=dnBook.begin(); it!=dnBook.end() && it->first>=lo; it=dnBook.erase(it)){
+            fired.push_back(it->second); trades[it->second.trade].has_dn=false;
+        }
+        for(const auto& f: fired)
+            if(f.kind==Kind::Profit && !trades[f.trade].done) finish(f.trade, i+1, true, true);
+        for(const auto& f: fired)
+            if(f.kind==Kind::Loss && !trades[f.trade].done) finish(f.trade, i+1, true, false);
+        for(const auto& f: fired){
+            if(f.kind!=Kind::Entry) continue;
+            auto& t=trades[f.trade];
+            t.open=true; t.open_bar=i;
+            place_orders(f.trade);
         }
+    }
+};
 
-        // Identify the timestamp column in the OHLCV file robustly
-        std::ifstream headIn(ohlcvPath);
-        if(!headIn){
-            std::cerr<<"❌ OHLCV missing\n";
-            continue;
+// Resolve every scannable job routed to `store` in one walk over its bars; sets their stop_at
+static void sweep_jobs(const std::vector<TriggerJob>& jobs, const OhlcvStore& store, std::vector<size_t>& stop_at){
+    SweepEngine eng;
+    std::vector<size_t> job_of;                                   // trade id -> job
+    std::vector<size_t> order;                                    // trades by first bar
+    for(size_t j=0;j<jobs.size();++j){
+        if(!jobs[j].scan || jobs[j].store!=&store) continue;
+        if(jobs[j].first>=jobs[j].last){ stop_at[j]=jobs[j].last; continue; }
+        order.push_back(eng.add(jobs[j].isBuy, jobs[j].L, jobs[j].rr.open_idx!=-1));
+        job_of.push_back(j);
+    }
+    auto job=[&](size_t t)->const TriggerJob&{ return jobs[job_of[t]]; };
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b){ return job(a).first<job(b).first; });
+
+    using Expiry = std::pair<size_t,size_t>;                      // (last bar, trade)
+    std::priority_queue<Expiry, std::vector<Expiry>, std::greater<Expiry>> expiries;
+
+    size_t next=0;
+    const size_t nbars = store.bars.size();
+    size_t i = order.empty() ? nbars : job(order[0]).first;
+    for(; i<nbars; ++i){
+        while(!expiries.empty() && expiries.top().first<=i){
+            size_t t=expiries.top().second; expiries.pop();
+            if(!eng.trades[t].done) eng.finish(t, job(t).last, false, false);
+        }
+        while(next<order.size() && job(order[next]).first<=i){
+            size_t t=order[next++];
+            eng.activate(t);
+            expiries.push({job(t).last, t});
         }
-        std::string hdr;
-        if(!getline_nonempty(headIn,hdr)){
-            std::cerr<<"❌ OHLCV empty\n";
+        if(eng.active==0){
+            if(next>=order.size()) break;
+            i = job(order[next]).first-1;                         // skip idle stretch
             continue;
         }
-        auto oH = splitCSV(hdr);
-        int ts_idx = -1;
-        for(int i=0;i<(int)oH.size();++i){
-            std::string k = norm_alnum(oH[i]);
-            if(k.rfind("ohlcv",0)==0) k.erase(0,5);
-            if(k=="tsevent"||k=="timestamp"||k=="datetime"||k=="date"||k=="time"||k=="ts"){
-                ts_idx=i; break;
+        eng.on_bar(i, store.bars.high[i], store.bars.low[i]);
+    }
+    for(size_t t: order){
+        if(!eng.trades[t].done) eng.finish(t, job(t).last, false, false);
+        stop_at[job_of[t]]=eng.trades[t].stop_at;
+    }
+}
+
+// Trigger preparation and output run on the worker pool; the sweep is one serial
+// pass per instrument partition, and partitions are swept in parallel
+static void sweep_process(const std::vector<TriggerInput>& triggers,
+                          const std::string& outDir,
+                          const OhlcvPartitions& data,
+                          int horizon_min,
+                          unsigned threads,
+                          ResultCache* cache)
+{
+    fs::create_directories(outDir);
+
+    // cached triggers are written straight away; the rest join the sweep
+    std::vector<TriggerJob> prepared(triggers.size());
+    std::vector<char> ok(triggers.size(), 0), cachedFilled(triggers.size(), 0);
+    TradeBook trades;
+    parallel_for(triggers.size(), threads, [&](size_t k){
+        if(!load_trigger_job(triggers[k], data, prepared[k])) return;
+        bool hit=false;
+        if(cache && replay_cached_result(*cache, triggers[k], horizon_min, prepared[k], outDir, hit)){
+            cachedFilled[k]=hit;
+            trades.put(std::move(prepared[k].trade));
+            row_pool().give(prepared[k].rows);
+            return;
+        }
+        ok[k] = plan_trigger_job(triggers[k], horizon_min, prepared[k]);
+    });
+    std::vector<TriggerJob> jobs;
+    jobs.reserve(triggers.size());
+    for(size_t k=0;k<triggers.size();++k) if(ok[k]) jobs.push_back(std::move(prepared[k]));
+    std::vector<size_t> stop_at(jobs.size(), 0);
+    parallel_for(data.parts.size(), threads, [&](size_t p){ sweep_jobs(jobs, data.parts[p], stop_at); });
+
+    std::vector<char> filled(jobs.size(), 0);
+    parallel_for(jobs.size(), threads, [&](size_t j){
+        filled[j] = write_trigger_job(jobs[j], stop_at[j], outDir).filled;
+        if(cache) store_result(*cache, jobs[j], stop_at[j], filled[j], outDir);
+        trades.put(std::move(jobs[j].trade));
+        row_pool().give(jobs[j].rows);
+    });
+    filled.insert(filled.end(), cachedFilled.begin(), cachedFilled.end());
+    report_resolved("Sweep", filled, triggers.size(), horizon_min, cache);
+    write_trades(trades, outDir);
+    write_metrics(trades, outDir, threads);
+}
+
+// ───────────────────────────── follow mode (tail the OHLCV file, resolve as bars arrive)
+// The OHLCV file is parsed once; after that only whole lines appended to it are
+// read, each bar into its instrument's partition. Triggers whose window is already
+// in the data are scanned at once. The rest stay in one SweepEngine per partition
+// that lives across appends, and each is written as soon as a bar decides it or a
+// bar past its horizon closes it. On exit (nothing left open, --idle-exit, or
+// Ctrl-C) the trades still open are written the way a scan over the bars read so
+// far would write them. Appended bars must not go back in time within their
+// instrument; any that do are dropped.
+struct OhlcvTail{
+    std::string path;
+    std::vector<int> src;            // file column of each kept column
+    size_t offset=0;                 // bytes consumed, always at a line start
+};
+static bool open_ohlcv_tail(const std::string& path, OhlcvStore& st, OhlcvTail& tail, unsigned threads){
+    tail = OhlcvTail{};
+    tail.path = path;
+    if(!parse_ohlcv_csv(path, st, threads, &tail.src, &tail.offset)) return false;
+    build_extrema_index(st.bars.high, st.bars.low, st.ext);
+    st.ok=true;
+    std::cout<<"✅ Loaded "<<st.bars.size()<<" OHLCV bars ← "<<path<<" (following)\n";
+    return true;
+}
+// Partition of an appended bar's key; an instrument not seen before gets a new one
+static size_t tail_partition(OhlcvPartitions& P, const std::string& key, const std::string& symbol){
+    if(P.key==BarCol::Ts) return 0;
+    auto it = P.byKey.find(key);
+    if(it!=P.byKey.end()) return it->second;
+    size_t k;
+    if(P.byKey.empty() && P.parts.size()==1 && P.parts[0].bars.size()==0){
+        k = 0;                                           // the file had no bars yet
+    }else{
+        OhlcvStore& st = P.parts.emplace_back();
+        st.header = P.none.header; st.cols = P.none.cols;
+        st.bars.nText = P.none.bars.nText;
+        std::copy(std::begin(P.none.bars.decimals), std::end(P.none.bars.decimals), std::begin(st.bars.decimals));
+        st.ok = true;
+        k = P.parts.size()-1;
+        log_line(std::cout, "➕ New instrument "+key+" in the OHLCV file\n");
+    }
+    register_partition(P, k, key, symbol);
+    return k;
+}
+// Parse the whole lines appended since the last call into their partitions; returns the number of bars added.
+// The extrema index is not extended; follow mode scans the raw columns instead.
+static size_t read_ohlcv_tail(OhlcvTail& tail, OhlcvPartitions& P){
+    std::error_code ec;
+    const uintmax_t size = fs::file_size(tail.path, ec);
+    if(ec || size==tail.offset) return 0;
+    if(size<tail.offset) throw std::runtime_error("OHLCV file shrank while following: "+tail.path);
+
+    std::ifstream in(tail.path, std::ios::binary);
+    std::string buf((size_t)(size-tail.offset), '\0');
+    in.seekg((std::streamoff)tail.offset);
+    if(!in.read(buf.data(), (std::streamsize)buf.size())) return 0;
+    size_t nl = buf.rfind('\n');
+    if(nl==std::string::npos) return 0;              // no complete line yet
+    buf.resize(nl+1);
+    tail.offset += buf.size();
+
+    BarChunk chunk;
+    parse_bar_chunk(buf, P.none.cols, tail.src, chunk);
+    const BarTable& nb = chunk.bars;
+    std::vector<std::vector<size_t>> keep;           // per partition, in file order
+    std::vector<int64_t> last;
+    std::vector<int> partOf(nb.pool.strs.size(), -1);    // chunk key id -> partition
+    size_t dropped=0, added=0;
+    for(size_t i=0;i<nb.size();++i){
+        size_t k = 0;
+        if(P.key!=BarCol::Ts){
+            int& pk = partOf[partition_ids(nb, P.key)[i]];
+            if(pk<0) pk = (int)tail_partition(P, nb.pool.strs[partition_ids(nb, P.key)[i]], nb.pool.strs[nb.symbol[i]]);
+            k = (size_t)pk;
+        }
+        if(k>=keep.size()){
+            keep.resize(P.parts.size());
+            for(size_t j=last.size();j<P.parts.size();++j)
+                last.push_back(P.parts[j].bars.size() ? P.parts[j].bars.ts.back() : std::numeric_limits<int64_t>::min());
+        }
+        if(nb.ts[i]<last[k]){ ++dropped; continue; }
+        keep[k].push_back(i);
+        last[k] = nb.ts[i];
+    }
+    if(dropped)
+        log_line(std::cerr, "⚠️ "+std::to_string(dropped)+" appended bar(s) out of time order ignored\n");
+    for(size_t k=0;k<keep.size();++k){
+        if(keep[k].empty()) continue;
+        std::vector<BarChunk> part(1);
+        part[0].bars = gather_bars(nb, keep[k]);
+        bool sorted=true;
+        stitch_bar_chunks(part, P.parts[k].bars, sorted);
+        added += keep[k].size();
+    }
+    return added;
+}
+
+// Blocks until a watched file or directory may have changed or timeout_ms passed
+// (inotify on Linux, else a sleep). Returns the names of files finished in a
+// watched directory (closed after writing, or moved in); without inotify the
+// caller has to list the directory itself.
+struct FileWatch{
+    int fd=-1;
+    int dirWd=-1;
+    FileWatch(){
+#ifdef __linux__
+        fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+    }
+    FileWatch(const FileWatch&) = delete;
+    FileWatch& operator=(const FileWatch&) = delete;
+    ~FileWatch(){
+#ifdef __linux__
+        if(fd>=0) ::close(fd);
+#endif
+    }
+    bool watch_file(const std::string& path){
+#ifdef __linux__
+        return fd>=0 && inotify_add_watch(fd, path.c_str(), IN_MODIFY | IN_CLOSE_WRITE)>=0;
+#else
+        (void)path; return false;
+#endif
+    }
+    bool watch_dir(const std::string& path){
+#ifdef __linux__
+        if(fd>=0) dirWd = inotify_add_watch(fd, path.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        return dirWd>=0;
+#else
+        (void)path; return false;
+#endif
+    }
+    std::vector<std::string> wait(int timeout_ms){
+        std::vector<std::string> landed;
+#ifdef __linux__
+        if(fd>=0){
+            pollfd p{fd, POLLIN, 0};
+            if(::poll(&p, 1, timeout_ms)>0){
+                alignas(inotify_event) char buf[4096];
+                for(ssize_t n; (n=::read(fd, buf, sizeof buf))>0; )
+                    for(char* e=buf; e<buf+n; ){
+                        const inotify_event* ev = (const inotify_event*)e;
+                        if(ev->wd==dirWd && ev->len && (ev->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)))
+                            landed.emplace_back(ev->name);
+                        e += sizeof(inotify_event) + ev->len;
+                    }
             }
+            return landed;
         }
-        if(ts_idx==-1) ts_idx = 0; // fall back
-        headIn.close();
+#endif
+        std::this_thread::sleep_for(std::chrono::milliseconds(timeout_ms));
+        return landed;
+    }
+};
 
-        // write window
-        std::ifstream fin(ohlcvPath);
-        if(!fin) continue;
-        std::string line;
-        std::string winPath=(fs::path(outDir)/(strip_derivative_suffixes(e.path().stem().string())+
-                             "_Next"+std::to_string(end_off)+"Min.csv")).string();
-        std::ofstream fout(winPath);
-        if(!fout){
-            std::cerr<<"❌ Cannot write "<<winPath<<"\n";
+// Ctrl-C / SIGTERM end follow and watch mode cleanly (open trades are still written)
+static volatile std::sig_atomic_t g_stop_requested = 0;
+static void request_stop(int){ g_stop_requested = 1; }
+static void stop_on_signals(){
+    std::signal(SIGINT, request_stop);
+    std::signal(SIGTERM, request_stop);
+}
+
+// forward_scan_job over the raw columns, bars [job.first,to). `done` = an exit was hit.
+static size_t follow_scan_job(const TriggerJob& job, const BarTable& b, size_t to, bool& entered, bool& done){
+    const TradeLevels& L = job.L;
+    auto up=[&](size_t from, size_t end, double x){ return first_cmp<Cmp::GE>(b.high.data(), from, end, x); };
+    auto dn=[&](size_t from, size_t end, double x){ return first_cmp<Cmp::LE>(b.low.data(),  from, end, x); };
+    size_t i = job.first;
+    entered = job.rr.open_idx!=-1;
+    done = false;
+    if(!entered){
+        size_t e = job.isBuy ? up(i, to, L.stop) : dn(i, to, L.stop);
+        if(e>=to) return to;
+        entered = true;
+        i = e+1;
+    }
+    size_t p = job.isBuy ? up(i, to, L.profit) : dn(i, to, L.profit);
+    size_t l = job.isBuy ? dn(i, p, L.loss)    : up(i, p, L.loss);
+    done = l<p || p<to;
+    return l<p ? l+1 : p<to ? p+1 : to;
+}
+
+struct FollowEngine{
+    using Timed = std::pair<std::time_t,size_t>;             // (ET time, trade id)
+    using MinHeap = std::priority_queue<Timed, std::vector<Timed>, std::greater<Timed>>;
+
+    // Open trades of one instrument partition
+    struct Lane{
+        const OhlcvStore* store=nullptr;
+        SweepEngine eng;
+        std::vector<TriggerJob> live;                         // by SweepEngine trade id
+        std::vector<char> written;
+        MinHeap waiting;                                      // not started yet, by window start
+        MinHeap expiries;                                     // started, by window end
+    };
+
+    std::string outDir;
+    ResultCache* cache;                                       // final results are recorded here (may be null)
+    std::deque<Lane> lanes;
+    size_t open=0, total=0;
+    int resolved=0;
+    bool timing=false;                                        // report latency of emitted results
+    std::chrono::steady_clock::time_point batchRead;          // when the current bars (or files) were read
+    std::string since = "its bar was read";
+    double latSum=0, latMax=0;
+    size_t latN=0;
+    TradeBook trades;                                         // every written result, for Trades.csv / .bin
+
+    explicit FollowEngine(std::string dir, ResultCache* rc=nullptr) : outDir(std::move(dir)), cache(rc) {}
+
+    Lane* find_lane(const OhlcvStore& st){
+        for(auto& ln: lanes) if(ln.store==&st) return &ln;
+        return nullptr;
+    }
+    Lane& lane_for(const OhlcvStore& st){
+        if(Lane* ln = find_lane(st)) return *ln;
+        lanes.emplace_back().store = &st;
+        return lanes.back();
+    }
+    // Latency of one written result, measured from batchRead
+    void report(const std::string& outName, const char* note=""){
+        if(!timing) return;
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now()-batchRead).count();
+        const double msv = us/1000.0;
+        latSum += msv; latMax = std::max(latMax, msv); ++latN;
+        char ms[32]; std::snprintf(ms, sizeof ms, "%.2f", msv);
+        log_line(std::cout, "⚡ "+outName+" ("+ms+" ms after "+since+note+")\n");
+    }
+    // `final`: more bars cannot change the result, so it may go into the result cache
+    void emit(TriggerJob& job, size_t stop_at, bool final){
+        const bool filled = write_trigger_job(job, stop_at, outDir).filled;
+        resolved += filled;
+        if(cache && final && job.key) store_result(*cache, job, stop_at, filled, outDir);
+        trades.put(job.trade);
+        row_pool().give(job.rows);
+        report(job.outName);
+    }
+    void emit_live(Lane& ln, size_t id, size_t stop_at, bool final){
+        if(ln.written[id]) return;
+        ln.written[id]=1; --open;
+        emit(ln.live[id], stop_at, final);
+    }
+    size_t track(Lane& ln, TriggerJob&& job, bool entered){
+        size_t id = ln.eng.add(job.isBuy, job.L, entered);
+        ln.live.push_back(std::move(job));
+        ln.written.push_back(0);
+        ++open;
+        return id;
+    }
+    // A prepared job (planned against the bars read so far); true when it was written at once
+    bool add(TriggerJob job){
+        ++total;
+        if(!job.scan){ emit(job, 0, true); return true; }
+        Lane& ln = lane_for(*job.store);
+        const size_t n = ln.store->bars.size();
+        if(job.first>=n){                                    // window starts after the last bar
+            std::time_t start = job.start_et;
+            bool entered = job.rr.open_idx!=-1;
+            ln.waiting.push({start, track(ln, std::move(job), entered)});
+            return false;
+        }
+        bool entered=false, done=false;
+        size_t stop = follow_scan_job(job, ln.store->bars, job.last, entered, done);
+        if(done || job.last<n){ emit(job, done ? stop : job.last, true); return true; }
+        std::time_t end = job.end_et;
+        size_t id = track(ln, std::move(job), entered);
+        ln.eng.activate(id);
+        ln.expiries.push({end, id});
+        return false;
+    }
+    // One appended bar of a partition: close windows it lies past, open those it reaches, then run the books
+    void feed(const OhlcvStore& st, size_t i){
+        Lane* lp = find_lane(st);
+        if(!lp) return;                                       // no trades on this instrument
+        Lane& ln = *lp;
+        const std::time_t t = (std::time_t)st.bars.ts[i];
+        while(!ln.expiries.empty() && ln.expiries.top().first<t){
+            size_t id = ln.expiries.top().second; ln.expiries.pop();
+            if(ln.eng.trades[id].done) continue;
+            ln.eng.finish(id, i, false, false);
+            emit_live(ln, id, i, true);
+        }
+        while(!ln.waiting.empty() && ln.waiting.top().first<=t){
+            size_t id = ln.waiting.top().second; ln.waiting.pop();
+            ln.live[id].first = i;
+            if(ln.live[id].end_et<t){ emit_live(ln, id, i, true); continue; }   // the whole window fell in a gap
+            ln.eng.activate(id);
+            ln.expiries.push({ln.live[id].end_et, id});
+        }
+        ln.eng.on_bar(i, st.bars.high[i], st.bars.low[i]);
+        for(const auto& f: ln.eng.fired){
+            const auto& tr = ln.eng.trades[f.trade];
+            if(tr.done) emit_live(ln, f.trade, tr.stop_at, true);
+        }
+    }
+    // Trades still open at exit, as a scan over the bars read so far leaves them
+    void finish_all(){
+        timing = false;
+        for(auto& ln: lanes){
+            const size_t n = ln.store->bars.size();
+            for(; !ln.waiting.empty(); ln.waiting.pop()) ln.live[ln.waiting.top().second].first = n;
+            for(size_t id=0; id<ln.live.size(); ++id) emit_live(ln, id, n, false);
+        }
+    }
+};
+
+// Read the appended bars and feed them to the engine, partition by partition; returns the bars read
+static size_t feed_ohlcv_tail(OhlcvTail& tail, OhlcvPartitions& data, FollowEngine& fe, unsigned threads){
+    std::vector<size_t> before;
+    for(const auto& st: data.parts) before.push_back(st.bars.size());
+    const size_t added = read_ohlcv_tail(tail, data);
+    if(added==0) return 0;
+    for(size_t k=0;k<data.parts.size();++k){
+        const OhlcvStore& st = data.parts[k];
+        const size_t from = k<before.size() ? before[k] : 0;
+        if(from==st.bars.size()) continue;
+        if(fe.cache) extend_bar_hashes(*fe.cache, st, from, threads);
+        for(size_t i=from;i<st.bars.size();++i) fe.feed(st, i);
+    }
+    return added;
+}
+static size_t total_bars(const OhlcvPartitions& data){
+    size_t n=0;
+    for(const auto& st: data.parts) n += st.bars.size();
+    return n;
+}
+
+static void follow_process(const std::vector<TriggerInput>& triggers,
+                           const std::string& outDir,
+                           OhlcvPartitions& data,
+                           OhlcvTail& tail,
+                           int horizon_min,
+                           int poll_ms,
+                           int idle_exit_s)
+{
+    if(!data.ok()) throw std::runtime_error("OHLCV file needed to follow: "+tail.path);
+    fs::create_directories(outDir);
+    FollowEngine fe(outDir);
+
+    // Static_Data triggers need their first START_OFFSET_MIN minutes of bars before they can start
+    FollowEngine::MinHeap early;
+    auto admit=[&](size_t k){
+        TriggerJob job;
+        if(!load_trigger_job(triggers[k], data, job)) return;
+        if(!plan_trigger_job(triggers[k], horizon_min, job)) return;
+        fe.add(std::move(job));
+    };
+    for(size_t k=0;k<triggers.size();++k){
+        std::time_t ready = triggers[k].base_et + START_OFFSET_MIN*60;
+        if(triggers[k].file.empty() && ready>latest_bar_time(data)) early.push({ready, k});
+        else admit(k);
+    }
+    std::cout<<"\n👀 Following "<<tail.path<<": "<<fe.open<<" trade(s) open, "
+             <<early.size()<<" waiting for their first bars.\n";
+
+    FileWatch watch;
+    watch.watch_file(tail.path);
+    stop_on_signals();
+    auto idleSince = std::chrono::steady_clock::now();
+    while((fe.open>0 || !early.empty()) && !g_stop_requested){
+        watch.wait(poll_ms);
+        const auto seen = std::chrono::steady_clock::now();
+        fe.timing = true;
+        fe.batchRead = seen;
+        if(feed_ohlcv_tail(tail, data, fe, 0)==0){
+            if(idle_exit_s>0 && seen-idleSince>=std::chrono::seconds(idle_exit_s)){
+                std::cout<<"⏹ No new bars for "<<idle_exit_s<<" s; stopping.\n";
+                break;
+            }
             continue;
         }
-        fout<<hdr<<"\n";
-        while(std::getline(fin,line)){
-            auto c=splitCSV(line);
-            if(c.empty()) continue;
-            if((int)c.size()<=ts_idx) continue;
-            std::tm t{};
-            if(!parse_flex_ts(c[ts_idx], t)) continue;
-            std::time_t ts_et=et_epoch_from_et_tm(t);
-            if(ts_et>=start_et && ts_et<=end_et) fout<<line<<"\n";
+        idleSince = seen;
+        while(!early.empty() && early.top().first<=latest_bar_time(data)){
+            size_t k = early.top().second; early.pop();
+            admit(k);
+        }
+    }
+    if(g_stop_requested) std::cout<<"⏹ Stopped.\n";
+    fe.finish_all();
+    std::cout<<"\n🎯 Follow: "<<fe.resolved<<"/"<<fe.total<<" trade(s) resolved";
+    if(horizon_min>0) std::cout<<" within "<<horizon_min<<" min";
+    std::cout<<" ("<<total_bars(data)<<" bars).\n";
+    write_trades(fe.trades, outDir);
+    write_metrics(fe.trades, outDir, 0);
+}
+
+// ───────────────────────────── watch mode (resolver daemon over the trigger directory)
+// Keeps the OHLCV partitions and the result cache in memory and resolves each raw
+// trigger file as it lands in the trigger directory (inotify on Linux, else the
+// directory is listed every --poll-ms). The OHLCV file is followed as well, so a
+// trigger whose window is not complete yet stays open and is written when the
+// bars decide it, as in follow mode. Each file is handled once per run; files
+// already there at start are resolved first. Runs until Ctrl-C / SIGTERM or
+// --idle-exit seconds without new files or bars, then writes what is still open.
+static bool is_raw_trigger_file(const fs::path& p){
+    return p.extension()==".csv" && is_raw_trigger_name(p.filename().string());
+}
+static void watch_process(const std::string& triggerDir,
+                          const std::string& outDir,
+                          OhlcvPartitions& data,
+                          OhlcvTail& tail,
+                          int horizon_min,
+                          unsigned threads,
+                          int poll_ms,
+                          int idle_exit_s,
+                          ResultCache* cache)
+{
+    if(!data.ok()) throw std::runtime_error("OHLCV file needed to watch: "+tail.path);
+    fs::create_directories(outDir);
+    FollowEngine fe(outDir, cache);
+    std::unordered_set<std::string> seen;
+    size_t files=0;
+
+    // Load, replay or plan a batch of new files on the worker pool, then hand them to the engine in name order
+    auto resolve_files=[&](std::vector<fs::path> paths){
+        std::sort(paths.begin(), paths.end());
+        std::vector<TriggerInput> ins;
+        for(const auto& p: paths){
+            if(!seen.insert(p.filename().string()).second) continue;
+            TriggerInput in;
+            in.file=p; in.stem=p.stem().string();
+            ins.push_back(std::move(in));
+        }
+        std::vector<TriggerJob> jobs(ins.size());
+        std::vector<char> state(ins.size(), 0), hit(ins.size(), 0);    // state: 1 = from the cache, 2 = planned
+        parallel_for(ins.size(), threads, [&](size_t k){
+            if(!load_trigger_job(ins[k], data, jobs[k])){
+                log_line(std::cerr, "⚠️ Cannot read "+ins[k].file.string()+"\n");
+                return;
+            }
+            bool h=false;
+            if(cache && replay_cached_result(*cache, ins[k], horizon_min, jobs[k], outDir, h, true)){
+                hit[k]=h; state[k]=1;
+                return;
+            }
+            if(plan_trigger_job(ins[k], horizon_min, jobs[k])) state[k]=2;
+        });
+        for(size_t k=0;k<ins.size();++k){
+            files += state[k]!=0;
+            if(state[k]==1){
+                ++fe.total; fe.resolved += hit[k];
+                fe.trades.put(std::move(jobs[k].trade));
+                fe.report(jobs[k].outName, ", result cache");
+            }else if(state[k]==2 && !fe.add(std::move(jobs[k])) && fe.timing){
+                log_line(std::cout, "⏳ "+ins[k].stem+" is open; waiting for bars\n");
+            }
+        }
+    };
+
+    FileWatch watch;
+    watch.watch_file(tail.path);
+    const bool dirEvents = watch.watch_dir(triggerDir);        // before the first listing, so no file is missed
+    resolve_files(list_raw_triggers(triggerDir));
+    std::cout<<"\n👀 Watching "<<triggerDir<<" ("<<files<<" file(s) resolved at start, "
+             <<fe.open<<" trade(s) open). Ctrl-C to stop.\n";
+
+    stop_on_signals();
+    auto idleSince = std::chrono::steady_clock::now();
+    while(!g_stop_requested){
+        auto names = watch.wait(poll_ms);
+        const auto now = std::chrono::steady_clock::now();
+        fe.timing = true;
+
+        // bars first, so files landing in the same batch see them
+        fe.batchRead = now;
+        fe.since = "its bar was read";
+        bool busy = feed_ohlcv_tail(tail, data, fe, threads)>0;
+
+        std::vector<fs::path> landed;
+        if(dirEvents){
+            for(const auto& n: names){
+                fs::path p = fs::path(triggerDir)/n;
+                if(is_raw_trigger_file(p) && !seen.count(n)) landed.push_back(p);
+            }
+        }else{
+            for(const auto& p: list_raw_triggers(triggerDir))
+                if(!seen.count(p.filename().string())) landed.push_back(p);
+        }
+        if(!landed.empty()){
+            fe.batchRead = now;
+            fe.since = "the file landed";
+            resolve_files(std::move(landed));
+            busy = true;
+        }
+        if(busy){ idleSince = now; continue; }
+        if(idle_exit_s>0 && now-idleSince>=std::chrono::seconds(idle_exit_s)){
+            std::cout<<"⏹ No new files or bars for "<<idle_exit_s<<" s; stopping.\n";
+            break;
         }
-        fin.close();
-        fout.close();
+    }
+    if(g_stop_requested) std::cout<<"⏹ Stopped.\n";
+    const size_t latN = fe.latN;
+    const double latSum = fe.latSum, latMax = fe.latMax;
+    fe.finish_all();
+    std::cout<<"\n🎯 Watch: "<<fe.resolved<<"/"<<fe.total<<" trade(s) resolved from "<<files<<" file(s)";
+    if(horizon_min>0) std::cout<<" within "<<horizon_min<<" min";
+    if(cache) std::cout<<" ("<<cache->hits<<" from the result cache)";
+    std::cout<<".\n";
+    if(latN){
+        char buf[96];
+        std::snprintf(buf, sizeof buf, "⏱ %zu result(s) written while watching: %.2f ms average, %.2f ms max.\n",
+                      latN, latSum/latN, latMax);
+        std::cout<<buf;
+    }
+    write_trades(fe.trades, outDir);
+    write_metrics(fe.trades, outDir, threads);
+}
 
-        // merge + resolve
-        union_merge_and_resolve(e.path().string(), winPath, outDir);
+// ───────────────────────────── parameter grid (many settings, one load)
+// Every combination of slippage, entry offset, horizon and profit / stop-loss
+// distance is evaluated with the forward-scan rules against the same store and
+// trigger set. Per trigger, the entry bar is found once per offset and the
+// first profit / stop-loss touches once per offset and distance, up to the
+// longest horizon; horizons and slippages then only compare indices and
+// shift prices. Distances are from the entry stop; NaN means the trigger's own level.
+struct GridSpec{
+    std::vector<double> slippage{SLIPPAGE};
+    std::vector<int>    offsetMin{START_OFFSET_MIN};
+    std::vector<int>    horizonMin{end_off_for_attempt(MAX_ATTEMPTS)};   // 0 = to the end of the data
+    std::vector<double> tpDist{NAN}, slDist{NAN};
+};
+// Per combination tallies, summed over triggers
+struct GridCell{
+    int triggers=0, entered=0, profit=0, loss=0;
+    double pl=0;
+};
+struct GridTrigger{
+    bool isBuy=false, timed=false;
+    std::time_t base_et=0;
+    TradeLevels L;
+    std::vector<double> hi, lo;      // the trigger's own rows
+    const OhlcvStore* store=nullptr; // its instrument partition
+};
+static bool prepare_grid_trigger(const TriggerInput& in, const OhlcvPartitions& data, GridTrigger& g){
+    std::vector<std::string> H;
+    std::vector<std::vector<std::string>> rows;
+    if(!load_trigger_input(in, data, H, rows, g.store)) return false;
+    prepare_rows(H, rows);
+    if(!infer_side(in.stem, g.isBuy)) return false;
+    const LevelCols& c = header_schema(H).level[g.isBuy];
+    if(!level_cols_ok(c) || !find_trade_levels(c, rows, g.L)) return false;
+    for(const auto& r: rows){ g.hi.push_back(safe_stod(r[c.hi])); g.lo.push_back(safe_stod(r[c.lo])); }
+    g.timed = trigger_input_time(in, g.base_et);
+    return true;
+}
+// Index of combination (s,o,h,a,b) in the result vector
+static size_t grid_index(const GridSpec& G, size_t s, size_t o, size_t h, size_t a, size_t b){
+    return (((s*G.offsetMin.size() + o)*G.horizonMin.size() + h)*G.tpDist.size() + a)*G.slDist.size() + b;
+}
+static size_t grid_size(const GridSpec& G){
+    return G.slippage.size()*G.offsetMin.size()*G.horizonMin.size()*G.tpDist.size()*G.slDist.size();
+}
+static void grid_trigger(const GridSpec& G, const GridTrigger& g, std::vector<GridCell>& cells){
+    const OhlcvStore& store = *g.store;
+    const bool buy = g.isBuy;
+    const size_t nA = G.tpDist.size(), nB = G.slDist.size();
+    auto profit_level=[&](size_t a){ return std::isnan(G.tpDist[a]) ? g.L.profit : (buy ? g.L.stop+G.tpDist[a] : g.L.stop-G.tpDist[a]); };
+    auto loss_level  =[&](size_t b){ return std::isnan(G.slDist[b]) ? g.L.loss   : (buy ? g.L.stop-G.slDist[b] : g.L.stop+G.slDist[b]); };
+    // buy fills: open stop+slip, profit/loss level-slip; sells mirrored
+    auto pl_of=[&](double level, double slip){
+        return buy ? (level-slip) - (g.L.stop+slip) : (g.L.stop-slip) - (level+slip);
+    };
+    auto tally=[&](size_t o, size_t h, size_t a, size_t b, bool entered, int hit, double level){
+        for(size_t s=0;s<G.slippage.size();++s){
+            GridCell& c = cells[grid_index(G, s, o, h, a, b)];
+            ++c.triggers;
+            if(!entered) continue;
+            ++c.entered;
+            if(hit>0){ ++c.profit; c.pl += pl_of(level, G.slippage[s]); }
+            if(hit<0){ ++c.loss;   c.pl += pl_of(level, G.slippage[s]); }
+        }
+    };
+
+    // own rows: entry does not depend on the distances, exits do
+    std::vector<ResolveResult> own(nA*nB);
+    for(size_t a=0;a<nA;++a) for(size_t b=0;b<nB;++b){
+        TradeLevels L{g.L.stop, profit_level(a), loss_level(b)};
+        ResolveResult& rr = own[a*nB+b];
+        if(buy) resolve_scan<Side::Buy>(L, g.hi, g.lo, rr);
+        else    resolve_scan<Side::Sell>(L, g.hi, g.lo, rr);
     }
+    const bool ownEntered = own[0].open_idx!=-1;
+
+    const auto& ts = store.bars.ts;
+    const size_t n = store.ok ? store.bars.size() : 0;
+    std::vector<size_t> lastH(G.horizonMin.size(), 0);
+    size_t maxLast = 0;
+    for(size_t h=0;h<G.horizonMin.size();++h){
+        lastH[h] = G.horizonMin[h]>0
+            ? (size_t)(std::upper_bound(ts.begin(), ts.begin()+n, (int64_t)(g.base_et + (std::time_t)G.horizonMin[h]*60)) - ts.begin())
+            : n;
+        maxLast = std::max(maxLast, lastH[h]);
+    }
+    for(size_t o=0;o<G.offsetMin.size();++o){
+        size_t first = g.timed && n
+            ? (size_t)(std::lower_bound(ts.begin(), ts.begin()+n, (int64_t)(g.base_et + (std::time_t)G.offsetMin[o]*60)) - ts.begin())
+            : n;
+        // bar indices of the first touches up to the longest horizon; NONE = no touch
+        const size_t NONE = std::numeric_limits<size_t>::max();
+        auto found=[&](size_t i){ return i<maxLast ? i : NONE; };
+        size_t e = NONE, from = first;           // bar entry (when the own rows did not enter)
+        if(!ownEntered){
+            if(first<maxLast) e = found(buy ? first_high_at_or_above(store, first, maxLast, g.L.stop)
+                                            : first_low_at_or_below (store, first, maxLast, g.L.stop));
+            from = e==NONE ? maxLast : e+1;
+        }
+        std::vector<size_t> p(nA, NONE), l(nB, NONE);
+        if(from<maxLast){
+            for(size_t a=0;a<nA;++a)
+                p[a] = found(buy ? first_high_at_or_above(store, from, maxLast, profit_level(a))
+                                 : first_low_at_or_below (store, from, maxLast, profit_level(a)));
+            for(size_t b=0;b<nB;++b)
+                l[b] = found(buy ? first_low_at_or_below (store, from, maxLast, loss_level(b))
+                                 : first_high_at_or_above(store, from, maxLast, loss_level(b)));
+        }
+        for(size_t h=0;h<G.horizonMin.size();++h){
+            const size_t end = lastH[h];
+            const bool barEntry = !ownEntered && e<end;
+            for(size_t a=0;a<nA;++a) for(size_t b=0;b<nB;++b){
+                const ResolveResult& rr = own[a*nB+b];
+                if(rr.fill_idx!=-1){
+                    tally(o, h, a, b, true, rr.profit_hit ? 1 : -1, rr.profit_hit ? profit_level(a) : loss_level(b));
+                    continue;
+                }
+                if(!ownEntered && !barEntry){ tally(o, h, a, b, false, 0, 0); continue; }
+                if(l[b]<p[a] && l[b]<end)  tally(o, h, a, b, true, -1, loss_level(b));
+                else if(p[a]<end)          tally(o, h, a, b, true,  1, profit_level(a));
+                else                       tally(o, h, a, b, true,  0, 0);
+            }
+        }
+    }
+}
+static void write_grid_results(const std::string& path, const GridSpec& G, const std::vector<GridCell>& cells){
+    auto num=[](double v){ return std::isnan(v) ? std::string("file") : format_price(v); };
+    std::vector<std::string> H = {"slippage","offset_min","horizon_min","tp_distance","sl_distance",
+                                  "triggers","entered","profit_hits","loss_hits","open","win_rate","total_pl","avg_pl"};
+    std::vector<std::vector<std::string>> rows;
+    rows.reserve(cells.size());
+    for(size_t s=0;s<G.slippage.size();++s) for(size_t o=0;o<G.offsetMin.size();++o)
+    for(size_t h=0;h<G.horizonMin.size();++h) for(size_t a=0;a<G.tpDist.size();++a)
+    for(size_t b=0;b<G.slDist.size();++b){
+        const GridCell& c = cells[grid_index(G, s, o, h, a, b)];
+        int closed = c.profit + c.loss;
+        rows.push_back({format_price(G.slippage[s]), std::to_string(G.offsetMin[o]), std::to_string(G.horizonMin[h]),
+                        num(G.tpDist[a]), num(G.slDist[b]),
+                        std::to_string(c.triggers), std::to_string(c.entered), std::to_string(c.profit),
+                        std::to_string(c.loss), std::to_string(c.entered-closed),
+                        closed ? format_price((double)c.profit/closed) : std::string(),
+                        format_price(c.pl), closed ? format_price(c.pl/closed) : std::string()});
+    }
+    writeCSV_raw(path, H, rows);
+}
+static void grid_process(const std::vector<TriggerInput>& triggers,
+                         const std::string& outDir,
+                         const OhlcvPartitions& data,
+                         const GridSpec& G,
+                         unsigned threads)
+{
+    fs::create_directories(outDir);
+
+    // per-trigger tallies, summed in trigger order afterwards
+    std::vector<std::vector<GridCell>> per(triggers.size());
+    parallel_for(triggers.size(), threads, [&](size_t k){
+        GridTrigger g;
+        if(!prepare_grid_trigger(triggers[k], data, g)) return;
+        per[k].assign(grid_size(G), GridCell{});
+        grid_trigger(G, g, per[k]);
+    });
+    std::vector<GridCell> cells(grid_size(G));
+    for(const auto& v: per)
+        for(size_t i=0;i<v.size();++i){
+            cells[i].triggers+=v[i].triggers; cells[i].entered+=v[i].entered;
+            cells[i].profit+=v[i].profit; cells[i].loss+=v[i].loss; cells[i].pl+=v[i].pl;
+        }
+    write_grid_results((fs::path(outDir)/"Grid_Results.csv").string(), G, cells);
+    std::cout<<"\n🎯 Grid: "<<cells.size()<<" combination(s) over "<<triggers.size()<<" trigger(s).\n";
+}
+
+// ───────────────────────────── command line
+struct RunConfig{
+    // UPDATE paths
+    std::string triggerDir = "C:/Users/dedhi/OneDrive/Desktop/Project/Trigger_Windows/";
+    std::string outRoot    = "C:/Users/dedhi/OneDrive/Desktop/Project/Resolved_Trades_Attempt/";
+    std::string ohlcvPath  = "C:/Users/dedhi/OneDrive/Desktop/Project/OHLCV_1s_Data.csv";
+    std::string staticPath;                                   // Static_Data.csv: triggers taken from it instead of triggerDir
+    std::string mode       = "attempts";                      // attempts | scan | sweep | grid | follow | watch
+    bool barCache          = true;                            // reuse/write <ohlcv>.bcache
+    bool audit             = false;                           // attempts: keep intermediate CSVs
+    bool resultCache       = true;                            // scan/sweep/watch: replay unchanged triggers
+    std::string resultCacheDir;                               // default <outRoot>/Result_Cache
+    unsigned threads       = 0;                               // worker threads, 0 = one per core
+    int horizonMin         = end_off_for_attempt(MAX_ATTEMPTS); // scan: minutes after trade time, 0 = no limit
+    int pollMs             = 200;                             // follow/watch: longest wait between checks of the files
+    int idleExitS          = 0;                               // follow/watch: stop after this many idle seconds, 0 = never
+    int rowOffset          = OUTPUT_ROW_OFFSET;               // blank rows above each output header, 0 = none
+    GridSpec grid;                                            // grid: value lists (horizon defaults to horizonMin)
+    bool gridHorizonSet    = false;
+};
+// Comma-separated numbers; "file" (when allowed) stands for the trigger's own level (NaN)
+static std::vector<double> parse_grid_list(const std::string& opt, const std::string& v, bool allowFile){
+    std::vector<double> out;
+    for(const auto& cell: splitCSV(v)){
+        if(allowFile && tolower_str(cell)=="file"){ out.push_back(NAN); continue; }
+        double x = safe_stod(cell);
+        if(std::isnan(x) || x<0) throw std::runtime_error("Bad value '"+cell+"' for "+opt);
+        out.push_back(x);
+    }
+    if(out.empty()) throw std::runtime_error("Empty list for "+opt);
+    return out;
+}
+static std::vector<int> parse_grid_minutes(const std::string& opt, const std::string& v){
+    std::vector<int> out;
+    for(double x: parse_grid_list(opt, v, false)){
+        if(x!=std::floor(x)) throw std::runtime_error("Whole minutes expected for "+opt);
+        out.push_back((int)x);
+    }
+    return out;
+}
+static RunConfig parse_args(int argc, char** argv){
+    RunConfig cfg;
+    for(int i=1;i<argc;++i){
+        std::string a=argv[i];
+        auto value=[&]()->std::string{
+            if(i+1>=argc) throw std::runtime_error("Missing value for "+a);
+            return argv[++i];
+        };
+        if(a=="--triggers")         cfg.triggerDir=value();
+        else if(a=="--out")         cfg.outRoot=value();
+        else if(a=="--ohlcv")       cfg.ohlcvPath=value();
+        else if(a=="--static")      cfg.staticPath=value();
+        else if(a=="--mode")        cfg.mode=value();
+        else if(a=="--horizon-min") cfg.horizonMin=std::stoi(value());
+        else if(a=="--poll-ms")     cfg.pollMs=std::stoi(value());
+        else if(a=="--idle-exit")   cfg.idleExitS=std::stoi(value());
+        else if(a=="--row-offset")  cfg.rowOffset=std::stoi(value());
+        else if(a=="--no-bar-cache") cfg.barCache=false;
+        else if(a=="--audit")       cfg.audit=true;
+        else if(a=="--result-cache") cfg.resultCacheDir=value();
+        else if(a=="--no-result-cache") cfg.resultCache=false;
+        else if(a=="--threads"){
+            int n=std::stoi(value());
+            if(n<0) throw std::runtime_error("--threads must be >= 0");
+            cfg.threads=(unsigned)n;
+        }
+        else if(a=="--grid-slippage") cfg.grid.slippage=parse_grid_list(a, value(), false);
+        else if(a=="--grid-offset")   cfg.grid.offsetMin=parse_grid_minutes(a, value());
+        else if(a=="--grid-horizon"){ cfg.grid.horizonMin=parse_grid_minutes(a, value()); cfg.gridHorizonSet=true; }
+        else if(a=="--grid-tp")       cfg.grid.tpDist=parse_grid_list(a, value(), true);
+        else if(a=="--grid-sl")       cfg.grid.slDist=parse_grid_list(a, value(), true);
+        else throw std::runtime_error("Unknown option "+a);
+    }
+    if(cfg.mode!="attempts" && cfg.mode!="scan" && cfg.mode!="sweep" && cfg.mode!="grid" && cfg.mode!="follow" &&
+       cfg.mode!="watch")
+        throw std::runtime_error("Unknown mode "+cfg.mode);
+    if(cfg.mode=="watch" && !cfg.staticPath.empty())
+        throw std::runtime_error("--static cannot be used with --mode watch (it watches the trigger directory)");
+    if(cfg.horizonMin<0) throw std::runtime_error("--horizon-min must be >= 0");
+    if(cfg.pollMs<=0) throw std::runtime_error("--poll-ms must be > 0");
+    if(cfg.rowOffset<0) throw std::runtime_error("--row-offset must be >= 0");
+    if(!cfg.gridHorizonSet) cfg.grid.horizonMin={cfg.horizonMin};
+    return cfg;
 }
 
 // ───────────────────────────── main
-int main(){
+int main(int argc, char** argv){
     try{
-        // UPDATE paths
-        std::string triggerDir = "C:/Users/dedhi/OneDrive/Desktop/Project/Trigger_Windows/";
-        std::string outRoot    = "C:/Users/dedhi/OneDrive/Desktop/Project/Resolved_Trades_Attempt/";
-        std::string ohlcvPath  = "C:/Users/dedhi/OneDrive/Desktop/Project/OHLCV_1s_Data.csv";
+        RunConfig cfg = parse_args(argc, argv);
+        const std::string& triggerDir = cfg.triggerDir;
+        const std::string& outRoot    = cfg.outRoot;
+        g_row_offset = cfg.rowOffset;
 
         fs::create_directories(outRoot);
 
+        // OHLCV is parsed once and split by instrument; every attempt slices windows out of it.
+        // follow / watch read the CSV itself (no bar cache) and keep their place for the appends.
+        const bool tailing = cfg.mode=="follow" || cfg.mode=="watch";
+        OhlcvPartitions data;
+        OhlcvTail tail;
+        {
+            OhlcvStore store;
+            if(tailing) open_ohlcv_tail(cfg.ohlcvPath, store, tail, cfg.threads);
+            else load_ohlcv_store(cfg.ohlcvPath, store, cfg.threads, cfg.barCache);
+            partition_ohlcv(std::move(store), data);
+        }
+
+        // Static_Data rows go straight to the resolver; otherwise the Trigger_Windows files
+        const bool fromSheet = !cfg.staticPath.empty();
+        std::vector<TriggerInput> triggers;
+        if(fromSheet) triggers = static_trigger_inputs(cfg.staticPath);
+        else if(cfg.mode!="attempts" && cfg.mode!="watch") triggers = file_trigger_inputs(triggerDir);
+
+        // scan / sweep / watch results are cached per trigger across runs
+        ResultCache cache;
+        ResultCache* rc = nullptr;
+        if(cfg.resultCache && (cfg.mode=="scan" || cfg.mode=="sweep" || cfg.mode=="watch")){
+            open_result_cache(cache, cfg.resultCacheDir.empty() ? (fs::path(outRoot)/"Result_Cache").string()
+                                                                : cfg.resultCacheDir,
+                              data, cfg.horizonMin, cfg.threads);
+            rc = &cache;
+        }
+
+        if(cfg.mode=="scan"){
+            forward_scan_process(triggers, (fs::path(outRoot)/"Forward_Scan").string(), data, cfg.horizonMin, cfg.threads, rc);
+            if(rc) prune_result_cache(*rc);
+            return 0;
+        }
+        if(cfg.mode=="sweep"){
+            sweep_process(triggers, (fs::path(outRoot)/"Sweep").string(), data, cfg.horizonMin, cfg.threads, rc);
+            if(rc) prune_result_cache(*rc);
+            return 0;
+        }
+        if(cfg.mode=="grid"){
+            grid_process(triggers, (fs::path(outRoot)/"Grid").string(), data, cfg.grid, cfg.threads);
+            return 0;
+        }
+        if(cfg.mode=="follow"){
+            follow_process(triggers, (fs::path(outRoot)/"Follow").string(), data, tail,
+                           cfg.horizonMin, cfg.pollMs, cfg.idleExitS);
+            return 0;
+        }
+        if(cfg.mode=="watch"){
+            watch_process(triggerDir, (fs::path(outRoot)/"Watch").string(), data, tail,
+                          cfg.horizonMin, cfg.threads, cfg.pollMs, cfg.idleExitS, rc);
+            if(rc) prune_result_cache(*rc);
+            return 0;
+        }
+
         // Attempt 1: seed unresolved from raw triggers and resolve WITHOUT merging
         int attempt=1;
         std::string attemptDir=(fs::path(outRoot)/("Attempt_"+std::to_string(attempt))).string();
         fs::create_directories(attemptDir);
 
-        bool any_raw=false;
-        for(auto& e: fs::directory_iterator(triggerDir)){
+        bool any_raw=fromSheet && !triggers.empty();
+        if(fromSheet) write_trigger_seeds(triggers, data, attemptDir);
+        else for(auto& e: fs::directory_iterator(triggerDir)){
             if(!e.is_regular_file() || e.path().extension()!=".csv") continue;
-            std::string n=tolower_str(e.path().filename().string());
-            if(n.find("_merged")!=std::string::npos || n.find("_next")!=std::string::npos ||
-               n.find("_resolved")!=std::string::npos || n.find("_unresolved")!=std::string::npos)
-                continue;
+            if(!is_raw_trigger_name(e.path().filename().string())) continue;
             any_raw=true;
             fs::copy_file(e.path(), fs::path(attemptDir)/e.path().filename(),
                           fs::copy_options::overwrite_existing);
@@ -1036,7 +3941,8 @@ int main(){
         }
 
         std::cout<<"\n=========== Attempt "<<attempt<<" ==========="<<std::endl;
-        attempt_process(attempt, attemptDir, attemptDir, ohlcvPath);
+        TradeBook trades;                        // latest state of each trigger over the attempts
+        attempt_process(attempt, attemptDir, attemptDir, data, cfg.audit, cfg.threads, trades);
 
         while(attempt<MAX_ATTEMPTS){
             int nextAttempt=attempt+1;
@@ -1077,7 +3983,7 @@ int main(){
             }
 
             std::cout<<"\n=========== Attempt "<<nextAttempt<<" ==========="<<std::endl;
-            attempt_process(nextAttempt, nextDir, nextDir, ohlcvPath);
+            attempt_process(nextAttempt, nextDir, nextDir, data, cfg.audit, cfg.threads, trades);
 
             bool any_unresolved=false;
             {
@@ -1101,6 +4007,8 @@ int main(){
         }
         if(attempt>=MAX_ATTEMPTS)
             std::cout<<"\n⚠️ Reached MAX_ATTEMPTS ("<<MAX_ATTEMPTS<<"). Some trades may remain unresolved.\n";
+        write_trades(trades, outRoot);
+        write_metrics(trades, outRoot, cfg.threads);
 
     }catch(const std::exception& e){
         std::cerr<<"❌ Error: "<<e.what()<<"\n";
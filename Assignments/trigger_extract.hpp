@@ -0,0 +1,184 @@
+#pragma once
+// Buy/Sell trigger detection on Static_Data sheets, shared by Trigger.cpp
+// (writes triggers.csv) and finalcode.cpp (resolves the triggers directly).
+// The sheet is memory-mapped; the header is the first record that carries both
+// the "Buy Triggered" and "Sell Triggered" labels. Data rows are split only up
+// to those two columns, and in full only when one of them fires.
+#include <string>
+#include <string_view>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <functional>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "csv_tokenizer.hpp"
+
+// ✅ Check if numeric
+static inline bool trigger_is_number(std::string_view str) {
+    if (str.empty()) return false;
+    bool decimalPointFound = false;
+    for (char ch : str) {
+        if (ch == '.') {
+            if (decimalPointFound) return false;
+            decimalPointFound = true;
+        } else if (!isdigit((unsigned char)ch) && ch != '-') {
+            return false;
+        }
+    }
+    return true;
+}
+// A Buy/Sell Triggered cell fires when it holds a positive number
+static inline bool trigger_fired(std::string_view cell) {
+    return trigger_is_number(cell) && csv_to_double(cell) > 0;
+}
+
+// Header of a static sheet and its Buy Triggered / Sell Triggered columns
+struct TriggerSheet {
+    std::vector<std::string> header;
+    int buyIndex = -1, sellIndex = -1;
+};
+static inline bool locate_trigger_columns(TriggerSheet& sheet) {
+    sheet.buyIndex = sheet.sellIndex = -1;
+    for (size_t i = 0; i < sheet.header.size(); i++) {
+        std::string hLower = sheet.header[i];
+        std::transform(hLower.begin(), hLower.end(), hLower.begin(),
+                       [](unsigned char c){ return std::tolower(c); });
+        if (hLower.find("buy triggered") != std::string::npos) sheet.buyIndex = (int)i;
+        if (hLower.find("sell triggered") != std::string::npos) sheet.sellIndex = (int)i;
+    }
+    return sheet.buyIndex != -1 && sheet.sellIndex != -1;
+}
+// Skip the preamble rows up to and including the header; pos is left on the first data record
+static inline bool locate_trigger_header(std::string_view buf, size_t& pos, TriggerSheet& sheet) {
+    std::vector<std::string_view> fields;
+    std::string scratch;
+    std::string_view rec;
+    while (csv_next_record(buf, pos, rec)) {
+        csv_split_views(rec, fields, scratch);
+        sheet.header.assign(fields.begin(), fields.end());
+        if (locate_trigger_columns(sheet)) return true;
+    }
+    sheet.header.clear();
+    std::cerr << "Could not locate Buy Triggered / Sell Triggered columns." << std::endl;
+    return false;
+}
+
+// Walk the triggered rows of body (whole records): onRow(fields, isBuy) once per firing side
+template <class OnRow>
+static inline void scan_trigger_rows(std::string_view body, const TriggerSheet& sheet, OnRow&& onRow) {
+    const size_t need = (size_t)std::max(sheet.buyIndex, sheet.sellIndex) + 1;
+    std::vector<std::string_view> fields;
+    std::string scratch;
+    std::string_view rec;
+    size_t pos = 0;
+    while (csv_next_record(body, pos, rec)) {
+        csv_split_views(rec, fields, scratch, need);
+        if (fields.size() < need) continue;
+        const bool buy = trigger_fired(fields[sheet.buyIndex]);
+        const bool sell = trigger_fired(fields[sheet.sellIndex]);
+        if (!buy && !sell) continue;
+        csv_split_views(rec, fields, scratch);
+        if (buy)  onRow(fields, true);
+        if (sell) onRow(fields, false);
+    }
+}
+
+// Every trigger of a sheet, in file order (Buy before Sell on a row)
+static inline bool for_each_static_trigger(
+    const std::string& filePath, TriggerSheet& sheet,
+    const std::function<void(const std::vector<std::string>&, bool)>& onTrigger)
+{
+    MappedFile mf;
+    if (!mf.open(filePath)) {
+        std::cerr << "Error opening file: " << filePath << std::endl;
+        return false;
+    }
+    size_t pos = 0;
+    if (!locate_trigger_header(mf.view(), pos, sheet)) return false;
+    std::vector<std::string> cols;
+    scan_trigger_rows(mf.view().substr(pos), sheet,
+                      [&](const std::vector<std::string_view>& f, bool isBuy) {
+                          cols.assign(f.begin(), f.end());
+                          onTrigger(cols, isBuy);
+                      });
+    return true;
+}
+
+// triggers.csv straight from the sheet: header + ",Type", then every triggered row
+// with its side appended. The body is cut into record-aligned chunks scanned on
+// `threads` workers (0 = one per core); each chunk is written as soon as every
+// earlier one is out, so rows keep the sheet order. Returns false when the sheet
+// cannot be read; `count` is the number of trigger rows written.
+static inline bool extract_static_triggers(const std::string& filePath, std::ostream& out,
+                                           unsigned threads, TriggerSheet& sheet, size_t& count)
+{
+    count = 0;
+    MappedFile mf;
+    if (!mf.open(filePath)) {
+        std::cerr << "Error opening file: " << filePath << std::endl;
+        return false;
+    }
+    size_t pos = 0;
+    if (!locate_trigger_header(mf.view(), pos, sheet)) return false;
+
+    for (const auto& h : sheet.header) {
+        csv_write_field(out, h);
+        out << ",";
+    }
+    out << "Type\n";
+
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    const std::string_view body = mf.view().substr(pos);
+    const std::vector<size_t> bounds = csv_chunk_bounds(body, threads > 1 ? (size_t)threads * 4 : 1, threads);
+    const size_t nChunks = bounds.size() - 1;
+
+    std::vector<std::string> text(nChunks);
+    std::vector<size_t> rows(nChunks, 0);
+    std::vector<char> done(nChunks, 0);
+    std::mutex m;
+    std::condition_variable cv;
+    std::atomic<size_t> next{0};
+    auto work = [&] {
+        for (size_t k; (k = next++) < nChunks; ) {
+            std::string buf;
+            size_t n = 0;
+            scan_trigger_rows(body.substr(bounds[k], bounds[k+1] - bounds[k]), sheet,
+                              [&](const std::vector<std::string_view>& f, bool isBuy) {
+                                  for (const auto& v : f) {
+                                      csv_append_field(buf, v);
+                                      buf.push_back(',');
+                                  }
+                                  buf.append(isBuy ? "Buy\n" : "Sell\n");
+                                  ++n;
+                              });
+            std::lock_guard<std::mutex> lk(m);
+            text[k].swap(buf);
+            rows[k] = n;
+            done[k] = 1;
+            cv.notify_all();
+        }
+    };
+    std::vector<std::thread> pool;
+    const size_t nWorkers = std::min<size_t>(threads, nChunks);
+    if (nWorkers > 1) for (size_t t = 0; t < nWorkers; t++) pool.emplace_back(work);
+    else work();
+
+    for (size_t k = 0; k < nChunks; k++) {
+        std::string buf;
+        {
+            std::unique_lock<std::mutex> lk(m);
+            cv.wait(lk, [&] { return done[k] != 0; });
+            buf.swap(text[k]);
+            count += rows[k];
+        }
+        out.write(buf.data(), (std::streamsize)buf.size());
+    }
+    for (auto& t : pool) t.join();
+    return true;
+}